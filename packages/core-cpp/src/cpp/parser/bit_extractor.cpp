@@ -0,0 +1,72 @@
+#include "bit_extractor.hpp"
+#include <algorithm>
+
+uint64_t extractBits(const uint8_t* data, size_t data_length, uint32_t bit_offset, uint32_t bit_length) {
+  if (bit_length == 0 || bit_length > 64) {
+    return 0;
+  }
+
+  uint64_t result = 0;
+  uint32_t bits_remaining = bit_length;
+  uint32_t current_bit = bit_offset;
+
+  while (bits_remaining > 0) {
+    uint32_t byte_index = current_bit / 8;
+    uint32_t bit_in_byte = current_bit % 8;
+
+    if (byte_index >= data_length) {
+      break;
+    }
+
+    uint32_t bits_available = 8 - bit_in_byte;
+    uint32_t bits_to_read = std::min(bits_available, bits_remaining);
+
+    uint8_t mask = ((1 << bits_to_read) - 1) << (bits_available - bits_to_read);
+    uint8_t extracted = (data[byte_index] & mask) >> (bits_available - bits_to_read);
+
+    result = (result << bits_to_read) | extracted;
+
+    current_bit += bits_to_read;
+    bits_remaining -= bits_to_read;
+  }
+
+  return result;
+}
+
+BitExtractor BitExtractor::select(uint32_t bit_offset, uint32_t bit_length) {
+  BitExtractor extractor;
+  extractor.bit_offset_ = bit_offset;
+  extractor.bit_length_ = bit_length;
+  extractor.byte_offset_ = bit_offset / 8;
+  extractor.end_byte_ = (bit_offset + bit_length + 7) / 8;
+
+  if (bit_length == 0 || bit_length > 64) {
+    // extractBits() reads nothing, neither does the generic kind
+    extractor.end_byte_ = 0;
+    return extractor;
+  }
+
+  // Narrowest load covering the field from its first byte
+  uint32_t span = bit_offset % 8 + bit_length;
+  uint32_t load_bits = 0;
+  if (span <= 8) {
+    extractor.kind_ = Kind::Load8;
+    load_bits = 8;
+  } else if (span <= 16) {
+    extractor.kind_ = Kind::Load16;
+    load_bits = 16;
+  } else if (span <= 32) {
+    extractor.kind_ = Kind::Load32;
+    load_bits = 32;
+  } else if (span <= 64) {
+    extractor.kind_ = Kind::Load64;
+    load_bits = 64;
+  } else {
+    return extractor;
+  }
+
+  extractor.shift_ = static_cast<uint8_t>(load_bits - span);
+  extractor.mask_ = bit_length == 64 ? UINT64_MAX : (uint64_t{1} << bit_length) - 1;
+  extractor.end_byte_ = extractor.byte_offset_ + load_bits / 8;
+  return extractor;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <stdlib.h>
+#endif
+
+// Big-endian field of up to 64 bits starting at bit_offset, bit by bit. Bits past data_length are not read,
+// so a truncated field keeps only the bits that were captured.
+uint64_t extractBits(const uint8_t* data, size_t data_length, uint32_t bit_offset, uint32_t bit_length);
+
+// How to read one header field, chosen once when the protocol graph is built. Offsets are relative to the
+// start of a byte-aligned layer: the field is one unaligned big-endian load of 1, 2, 4 or 8 bytes, shifted
+// and masked. Fields spanning more than 8 bytes from their first byte fall back to extractBits().
+class BitExtractor {
+public:
+  enum class Kind : uint8_t { Load8, Load16, Load32, Load64, Generic };
+
+  static BitExtractor select(uint32_t bit_offset, uint32_t bit_length);
+
+  Kind getKind() const { return kind_; }
+  // Bytes read from the start of the layer, for the per-layer bounds check
+  uint32_t getEndByte() const { return end_byte_; }
+  // Any kind but Generic is also the 8-byte big-endian load at getByteOffset(), shifted by getWideShift() and
+  // masked with getMask(), which is how batch kernels read it
+  uint32_t getByteOffset() const { return byte_offset_; }
+  uint8_t getWideShift() const { return static_cast<uint8_t>(64 - (bit_offset_ % 8 + bit_length_)); }
+  uint64_t getMask() const { return mask_; }
+
+  // The layer must hold getEndByte() bytes from layer
+  uint64_t extract(const uint8_t* layer) const {
+    const uint8_t* p = layer + byte_offset_;
+    switch (kind_) {
+    case Kind::Load8:
+      return (static_cast<uint64_t>(*p) >> shift_) & mask_;
+    case Kind::Load16:
+      return (static_cast<uint64_t>(loadBigEndian16(p)) >> shift_) & mask_;
+    case Kind::Load32:
+      return (static_cast<uint64_t>(loadBigEndian32(p)) >> shift_) & mask_;
+    case Kind::Load64:
+      return (loadBigEndian64(p) >> shift_) & mask_;
+    default:
+      return extractBits(layer, end_byte_, bit_offset_, bit_length_);
+    }
+  }
+
+  static uint16_t loadBigEndian16(const uint8_t* p) {
+    uint16_t value;
+    std::memcpy(&value, p, sizeof(value));
+#if defined(_MSC_VER)
+    return _byteswap_ushort(value);
+#else
+    return __builtin_bswap16(value);
+#endif
+  }
+
+  static uint32_t loadBigEndian32(const uint8_t* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+#if defined(_MSC_VER)
+    return _byteswap_ulong(value);
+#else
+    return __builtin_bswap32(value);
+#endif
+  }
+
+  static uint64_t loadBigEndian64(const uint8_t* p) {
+    uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+#if defined(_MSC_VER)
+    return _byteswap_uint64(value);
+#else
+    return __builtin_bswap64(value);
+#endif
+  }
+
+private:
+  Kind kind_ = Kind::Generic;
+  uint8_t shift_ = 0;
+  uint32_t byte_offset_ = 0;
+  uint32_t end_byte_ = 0;
+  uint32_t bit_offset_ = 0;
+  uint32_t bit_length_ = 0;
+  uint64_t mask_ = 0;
+};
@@ -0,0 +1,148 @@
+#include "field_gather.hpp"
+#include "bit_extractor.hpp"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define FIELD_GATHER_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define FIELD_GATHER_TARGET(isa)
+#else
+#define FIELD_GATHER_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+namespace {
+
+#ifdef FIELD_GATHER_X86
+
+// Native byte order, the kernels swap whole registers
+long long load64(const uint8_t* p) {
+  long long value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+FIELD_GATHER_TARGET("avx2")
+void gatherFieldsAvx2(const uint8_t* layer, const FieldGatherPlan& plan, uint64_t* values) {
+  // Reverses the bytes of each 64-bit lane
+  const __m256i swap = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+                                        15, 14, 13, 12, 11, 10, 9, 8);
+  const uint32_t* offsets = plan.byte_offsets.data();
+  size_t count = plan.size();
+
+  size_t j = 0;
+  for (; j + 4 <= count; j += 4) {
+    // Four scalar loads, vpgatherqq is microcoded and slower on most cores
+    __m256i raw = _mm256_setr_epi64x(load64(layer + offsets[j]), load64(layer + offsets[j + 1]),
+                                     load64(layer + offsets[j + 2]), load64(layer + offsets[j + 3]));
+    __m256i shifts = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(plan.shifts.data() + j));
+    __m256i masks = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(plan.masks.data() + j));
+    __m256i value = _mm256_and_si256(_mm256_srlv_epi64(_mm256_shuffle_epi8(raw, swap), shifts), masks);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(values + j), value);
+  }
+  for (; j < count; j++) {
+    values[j] = (BitExtractor::loadBigEndian64(layer + offsets[j]) >> plan.shifts[j]) & plan.masks[j];
+  }
+}
+
+FIELD_GATHER_TARGET("sse4.2")
+void gatherFieldsSse42(const uint8_t* layer, const FieldGatherPlan& plan, uint64_t* values) {
+  const __m128i swap = _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+  const uint32_t* offsets = plan.byte_offsets.data();
+  size_t count = plan.size();
+
+  size_t j = 0;
+  for (; j + 2 <= count; j += 2) {
+    __m128i low = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(layer + offsets[j]));
+    __m128i high = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(layer + offsets[j + 1]));
+    __m128i swapped = _mm_shuffle_epi8(_mm_unpacklo_epi64(low, high), swap);
+    // No per-lane variable shift before AVX2: shift twice, keep one lane of each
+    __m128i low_shifted = _mm_srl_epi64(swapped, _mm_cvtsi64_si128(static_cast<long long>(plan.shifts[j])));
+    __m128i high_shifted = _mm_srl_epi64(swapped, _mm_cvtsi64_si128(static_cast<long long>(plan.shifts[j + 1])));
+    __m128i masks = _mm_loadu_si128(reinterpret_cast<const __m128i*>(plan.masks.data() + j));
+    __m128i value = _mm_and_si128(_mm_blend_epi16(low_shifted, high_shifted, 0xF0), masks);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(values + j), value);
+  }
+  for (; j < count; j++) {
+    values[j] = (BitExtractor::loadBigEndian64(layer + offsets[j]) >> plan.shifts[j]) & plan.masks[j];
+  }
+}
+
+bool cpuHasAvx2() {
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 1);
+  bool os_saves_ymm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+  __cpuidex(info, 7, 0);
+  return os_saves_ymm && (info[1] & (1 << 5)) != 0;
+#else
+  return __builtin_cpu_supports("avx2");
+#endif
+}
+
+bool cpuHasSse42() {
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 1);
+  return (info[2] & (1 << 20)) != 0;
+#else
+  return __builtin_cpu_supports("sse4.2");
+#endif
+}
+
+#endif
+
+struct SelectedKernel {
+  FieldGatherKernel kernel = gatherFieldsScalar;
+  const char* name = "scalar";
+
+  SelectedKernel() {
+#ifdef FIELD_GATHER_X86
+    if (cpuHasAvx2()) {
+      kernel = gatherFieldsAvx2;
+      name = "avx2";
+    } else if (cpuHasSse42()) {
+      kernel = gatherFieldsSse42;
+      name = "sse4.2";
+    }
+#endif
+  }
+};
+
+const SelectedKernel& selected() {
+  static const SelectedKernel kernel;
+  return kernel;
+}
+
+} // namespace
+
+void FieldGatherPlan::add(const BitExtractor& extractor) {
+  if (extractor.getKind() == BitExtractor::Kind::Generic) {
+    generic.push_back(static_cast<uint32_t>(size()));
+    byte_offsets.push_back(0);
+    shifts.push_back(0);
+    masks.push_back(0);
+  } else {
+    byte_offsets.push_back(extractor.getByteOffset());
+    shifts.push_back(extractor.getWideShift());
+    masks.push_back(extractor.getMask());
+  }
+  extent_bytes = std::max(extent_bytes, byte_offsets.back() + 8);
+}
+
+void gatherFieldsScalar(const uint8_t* layer, const FieldGatherPlan& plan, uint64_t* values) {
+  for (size_t j = 0; j < plan.size(); j++) {
+    values[j] = (BitExtractor::loadBigEndian64(layer + plan.byte_offsets[j]) >> plan.shifts[j]) & plan.masks[j];
+  }
+}
+
+FieldGatherKernel selectFieldGatherKernel() {
+  return selected().kernel;
+}
+
+const char* getFieldGatherKernelName() {
+  return selected().name;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "./bit_extractor.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// The fields of one protocol as 8-byte big-endian loads from the start of a byte-aligned layer, each shifted
+// right and masked, laid out so SIMD kernels load shifts and masks straight into registers
+struct FieldGatherPlan {
+  std::vector<uint32_t> byte_offsets;
+  std::vector<uint64_t> shifts;
+  std::vector<uint64_t> masks;
+  std::vector<uint32_t> generic; // Entries too wide for one load, gathered as 0 and left to extractBits()
+  uint32_t extent_bytes = 0;     // Bytes the furthest load reads
+
+  void add(const BitExtractor& extractor);
+  size_t size() const { return byte_offsets.size(); }
+};
+
+// Writes values[j] for every field j of plan; the layer must have plan.extent_bytes readable bytes
+using FieldGatherKernel = void (*)(const uint8_t* layer, const FieldGatherPlan& plan, uint64_t* values);
+
+// AVX2 (four fields per register) or SSE4.2 (two) when the CPU has it, scalar otherwise. Chosen on first call.
+FieldGatherKernel selectFieldGatherKernel();
+// "avx2", "sse4.2" or "scalar", for logs and tests
+const char* getFieldGatherKernelName();
+
+void gatherFieldsScalar(const uint8_t* layer, const FieldGatherPlan& plan, uint64_t* values);
@@ -0,0 +1,77 @@
+#include "generated_parser.hpp"
+#include <iostream>
+
+GeneratedParser::GeneratedParser() : interpreted_(std::make_unique<PacketParser>()) {}
+
+GeneratedParser::~GeneratedParser() = default;
+
+void GeneratedParser::setProtocolEntryFile(const std::string& path) {
+  interpreted_->setProtocolEntryFile(path);
+  graph_ = interpreted_->getGraph();
+  table_ = nullptr;
+  if (!graph_ || graph_->entry() == nullptr) {
+    return;
+  }
+
+  const GeneratedProtocolTable* table = getGeneratedProtocolTable();
+  if (table != nullptr && table->node_count == graph_->size() && graph_->getSignature() == table->signature) {
+    table_ = table;
+  } else {
+    std::cerr << "Warning: protocol files from " << path
+              << " differ from the ones the parser was generated from, interpreting them" << std::endl;
+  }
+}
+
+const std::string& GeneratedParser::getProtocolEntryFile() const {
+  return interpreted_->getProtocolEntryFile();
+}
+
+std::unique_ptr<ParserModel> GeneratedParser::clone() const {
+  auto parser = std::make_unique<GeneratedParser>();
+  parser->interpreted_.reset(static_cast<PacketParser*>(interpreted_->clone().release()));
+  parser->graph_ = graph_;
+  parser->table_ = table_;
+  return parser;
+}
+
+void GeneratedParser::parsePacket(const PacketView& packet, ParsedPacket& out) {
+  if (table_ == nullptr) {
+    interpreted_->parsePacket(packet, out);
+    return;
+  }
+
+  out.clear();
+  if (out.graph != graph_) {
+    out.graph = graph_;
+  }
+  if (packet.data == nullptr || packet.length == 0) {
+    return;
+  }
+
+  uint32_t node = 0;
+  uint32_t bit_offset = 0;
+  while (node != NO_PROTOCOL_NODE && out.layers.size() < PARSER_MAX_LAYERS) {
+    size_t first_value = out.values.size();
+    out.layers.push_back({node, bit_offset, static_cast<uint32_t>(first_value)});
+    out.values.resize(first_value + table_->field_counts[node]);
+    node = table_->decoders[node](packet.data, packet.length, bit_offset, out.values.data() + first_value);
+  }
+}
+
+void GeneratedParser::parseBatch(const PacketView* packets, ParsedPacket* out, size_t count) {
+  if (table_ == nullptr) {
+    interpreted_->parseBatch(packets, out, count);
+    return;
+  }
+  for (size_t i = 0; i < count; i++) {
+    parsePacket(packets[i], out[i]);
+  }
+}
+
+void GeneratedParser::parseChain(const PacketView& packet, ParsedPacket& out) {
+  if (table_ == nullptr) {
+    interpreted_->parseChain(packet, out);
+    return;
+  }
+  parsePacket(packet, out);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "../utils/packets/packet_model.hpp"
+#include "./generated_protocols.hpp"
+#include "./packet_parser.hpp"
+#include "./parser_model.hpp"
+#include "./protocol_graph.hpp"
+#include <memory>
+#include <string>
+
+// Parses with the C++ tools/protocol_codegen.cpp generated from the bundled protocol files at build time: one
+// decode function per protocol with every field width, offset, mapping and start_after as a constant. Results
+// are identical to PacketParser's. The protocol files are still loaded for names and keys, and when they no longer
+// match the generated graph (edited, or supplied by the user) packets go through the interpreting PacketParser.
+class GeneratedParser : public ParserModel {
+private:
+  std::unique_ptr<PacketParser> interpreted_;
+  std::shared_ptr<const ProtocolGraph> graph_;
+  // Null while parsing falls back to interpreted_
+  const GeneratedProtocolTable* table_ = nullptr;
+
+public:
+  GeneratedParser();
+  ~GeneratedParser() override;
+
+  using ParserModel::parseBatch;
+  using ParserModel::parsePacket;
+  void parsePacket(const PacketView& packet, ParsedPacket& out) override;
+  void parseBatch(const PacketView* packets, ParsedPacket* out, size_t count) override;
+  // Generated code decodes every field as cheaply as the chain alone, so this is parsePacket() unless falling back
+  void parseChain(const PacketView& packet, ParsedPacket& out) override;
+  void setProtocolEntryFile(const std::string& path) override;
+  const std::string& getProtocolEntryFile() const override;
+  std::unique_ptr<ParserModel> clone() const override;
+
+  // Whether the generated code parses the current protocol files
+  bool isGenerated() const { return table_ != nullptr; }
+  const std::shared_ptr<const ProtocolGraph>& getGraph() const { return graph_; }
+};
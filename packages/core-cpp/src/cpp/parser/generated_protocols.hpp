@@ -0,0 +1,82 @@
+#pragma once
+
+#include "./bit_extractor.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+// Building blocks of the C++ that tools/protocol_codegen.cpp emits for a protocol graph, and the table
+// GeneratedParser runs it through. Free of N-API, so the generator builds without Node.
+
+// One header field, as in the protocol file's "offset_length" key
+struct GeneratedField {
+  uint32_t offset;
+  uint32_t length;
+};
+
+// Big-endian load of one width, specialized per width
+template <uint32_t Bytes> struct BigEndianLoad;
+template <> struct BigEndianLoad<1> {
+  static uint64_t load(const uint8_t* p) { return *p; }
+};
+template <> struct BigEndianLoad<2> {
+  static uint64_t load(const uint8_t* p) { return BitExtractor::loadBigEndian16(p); }
+};
+template <> struct BigEndianLoad<4> {
+  static uint64_t load(const uint8_t* p) { return BitExtractor::loadBigEndian32(p); }
+};
+template <> struct BigEndianLoad<8> {
+  static uint64_t load(const uint8_t* p) { return BitExtractor::loadBigEndian64(p); }
+};
+
+// BitExtractor::select() resolved at compile time: the narrowest load covering the field from its first byte,
+// a shift and a mask, or extractBits() for fields spanning more than 8 bytes. The layer must be byte-aligned
+// and hold EndByte bytes.
+template <uint32_t BitOffset, uint32_t BitLength> struct FieldReader {
+  static constexpr bool valid = BitLength != 0 && BitLength <= 64;
+  static constexpr uint32_t byte_offset = BitOffset / 8;
+  static constexpr uint32_t span = BitOffset % 8 + BitLength;
+  static constexpr uint32_t load_bytes = span <= 8 ? 1 : span <= 16 ? 2 : span <= 32 ? 4 : span <= 64 ? 8 : 0;
+  static constexpr uint32_t end_byte =
+      !valid ? 0 : load_bytes != 0 ? byte_offset + load_bytes : (BitOffset + BitLength + 7) / 8;
+
+  static uint64_t read(const uint8_t* layer) {
+    if constexpr (!valid) {
+      return 0;
+    } else if constexpr (load_bytes == 0) {
+      return extractBits(layer, end_byte, BitOffset, BitLength);
+    } else {
+      constexpr uint32_t shift = load_bytes * 8 - span;
+      constexpr uint64_t mask = BitLength == 64 ? UINT64_MAX : (uint64_t{1} << BitLength) - 1;
+      return (BigEndianLoad<load_bytes>::load(layer + byte_offset) >> shift) & mask;
+    }
+  }
+};
+
+// values[i] for every field of a constexpr table, one FieldReader each
+template <const GeneratedField* Fields, size_t... I>
+void readFields(const uint8_t* layer, uint64_t* values, std::index_sequence<I...>) {
+  ((values[I] = FieldReader<Fields[I].offset, Fields[I].length>::read(layer)), ...);
+}
+
+// Same fields bit by bit, for a truncated or unaligned layer
+template <const GeneratedField* Fields, size_t... I>
+void extractFieldBits(const uint8_t* data, size_t length, uint32_t bit_offset, uint64_t* values,
+                      std::index_sequence<I...>) {
+  ((values[I] = extractBits(data, length, bit_offset + Fields[I].offset, Fields[I].length)), ...);
+}
+
+// The generated parser of one protocol graph
+struct GeneratedProtocolTable {
+  // Writes the fields of the node's layer at bit_offset to values and returns the next node, moving bit_offset
+  // to it; UINT32_MAX (NO_PROTOCOL_NODE) when decoding stops
+  using DecodeLayer = uint32_t (*)(const uint8_t* data, size_t length, uint32_t& bit_offset, uint64_t* values);
+
+  const char* signature; // ProtocolGraph::getSignature() of the graph the code was generated from
+  size_t node_count;
+  const uint32_t* field_counts; // By node id
+  const DecodeLayer* decoders;  // By node id
+};
+
+// Defined by the generated source, null when the graph could not be generated (start_after needing ExprTk)
+const GeneratedProtocolTable* getGeneratedProtocolTable();
@@ -1,174 +1,206 @@
 #include "packet_parser.hpp"
+#include <algorithm>
 #include <exprtk.hpp>
-#include <filesystem>
 #include <iostream>
 #include <regex>
-#include <sstream>
-#include <stdexcept>
 
-namespace fs = std::filesystem;
+struct PacketParser::ExprtkStartAfter {
+  exprtk::symbol_table<double> symbols;
+  exprtk::expression<double> expression;
+  std::vector<double> variables; // One per field of the node, bound as field_<offset>_<length>
+  bool valid = false;
+};
+
+PacketParser::PacketParser() : gather_kernel_(selectFieldGatherKernel()) {}
+
+PacketParser::~PacketParser() = default;
 
 void PacketParser::setProtocolEntryFile(const std::string& path) {
   protocol_entry_file_ = path;
+  graph_ = ProtocolGraph::build(path);
+  exprtk_start_after_.clear();
 }
 
-uint64_t PacketParser::extractBits(const uint8_t* data, size_t data_length, uint32_t bit_offset,
-                                   uint32_t bit_length) const {
-  if (bit_length == 0 || bit_length > 64) {
-    return 0;
-  }
-
-  uint64_t result = 0;
-  uint32_t bits_remaining = bit_length;
-  uint32_t current_bit = bit_offset;
-
-  while (bits_remaining > 0) {
-    uint32_t byte_index = current_bit / 8;
-    uint32_t bit_in_byte = current_bit % 8;
-
-    if (byte_index >= data_length) {
-      break;
-    }
-
-    uint32_t bits_available = 8 - bit_in_byte;
-    uint32_t bits_to_read = std::min(bits_available, bits_remaining);
-
-    uint8_t mask = ((1 << bits_to_read) - 1) << (bits_available - bits_to_read);
-    uint8_t extracted = (data[byte_index] & mask) >> (bits_available - bits_to_read);
-
-    result = (result << bits_to_read) | extracted;
-
-    current_bit += bits_to_read;
-    bits_remaining -= bits_to_read;
-  }
+const std::string& PacketParser::getProtocolEntryFile() const {
+  return protocol_entry_file_;
+}
 
-  return result;
+std::unique_ptr<ParserModel> PacketParser::clone() const {
+  auto parser = std::make_unique<PacketParser>();
+  parser->protocol_entry_file_ = protocol_entry_file_;
+  parser->graph_ = graph_;
+  return parser;
 }
 
-uint32_t PacketParser::evaluateStartAfter(const std::string& expression,
-                                          const std::unordered_map<std::string, uint64_t>& field_values) const {
-  if (expression.empty()) {
-    return 0;
+uint32_t PacketParser::evaluateStartAfter(const ProtocolNode& node, const uint64_t* field_values) {
+  if (node.start_after.isNative()) {
+    return node.start_after.evaluate(field_values);
   }
 
-  if (expression.find("calculate:") == 0) {
-    if (expression.length() <= 10) {
-      return 0;
-    }
-    std::string expr_str = expression.substr(10);
+  if (exprtk_start_after_.size() < graph_->size()) {
+    exprtk_start_after_.resize(graph_->size());
+  }
+  std::unique_ptr<ExprtkStartAfter>& compiled = exprtk_start_after_[node.id];
 
-    while (!expr_str.empty() && expr_str[0] == ' ') {
-      expr_str.erase(0, 1);
+  if (!compiled) {
+    compiled = std::make_unique<ExprtkStartAfter>();
+    compiled->variables.resize(node.fields.size());
+    for (size_t i = 0; i < node.fields.size(); i++) {
+      compiled->symbols.add_variable("field_" + node.fields[i].key, compiled->variables[i]);
     }
+    compiled->expression.register_symbol_table(compiled->symbols);
 
+    // [offset_length] becomes the field's variable, or 0 when the header has no such field
     std::regex field_regex(R"(\[(\d+_\d+)\])");
-    std::string processed_expr = expr_str;
+    std::string processed_expr;
+    std::string remaining = node.start_after.getExpression();
     std::smatch match;
-
-    while (std::regex_search(processed_expr, match, field_regex)) {
-      std::string field_key = match[1].str();
-      auto it = field_values.find(field_key);
-      if (it != field_values.end()) {
-        processed_expr = match.prefix().str() + std::to_string(it->second) + match.suffix().str();
-      } else {
-        processed_expr = match.prefix().str() + "0" + match.suffix().str();
-      }
+    while (std::regex_search(remaining, match, field_regex)) {
+      bool known = std::any_of(node.fields.begin(), node.fields.end(),
+                               [&match](const FieldDescriptor& field) { return field.key == match[1].str(); });
+      processed_expr += match.prefix().str() + (known ? "field_" + match[1].str() : "0");
+      remaining = match.suffix().str();
     }
+    processed_expr += remaining;
 
-    exprtk::expression<double> expr;
     exprtk::parser<double> parser;
-
-    if (parser.compile(processed_expr, expr)) {
-      return static_cast<uint32_t>(expr.value());
+    compiled->valid = parser.compile(processed_expr, compiled->expression);
+    if (!compiled->valid) {
+      std::cerr << "Warning: invalid start_after expression in " << node.file << ": "
+                << node.start_after.getExpression() << std::endl;
     }
-
-    return 0;
   }
 
-  try {
-    return static_cast<uint32_t>(std::stoul(expression));
-  } catch (...) {
+  if (!compiled->valid) {
     return 0;
   }
+  for (size_t i = 0; i < compiled->variables.size(); i++) {
+    compiled->variables[i] = static_cast<double>(field_values[i]);
+  }
+  return StartAfter::toBits(compiled->expression.value());
 }
 
-std::string PacketParser::resolveProtocolPath(const std::string& current_path, const std::string& relative_path) const {
-  fs::path current(current_path);
-  fs::path parent = current.parent_path();
-  fs::path resolved = parent / relative_path;
-  return resolved.lexically_normal().string();
-}
-
-ParsedPacket PacketParser::parsePacket(const RawPacket& raw_packet) {
-  ParsedPacket result;
+uint64_t PacketParser::decodeLayer(const PacketView& packet, const ProtocolNode& node, uint32_t bit_offset,
+                                   ParsedPacket& out) {
+  size_t first_value = out.values.size();
+  out.layers.push_back({node.id, bit_offset, static_cast<uint32_t>(first_value)});
+  out.values.resize(first_value + node.fields.size());
+  node.extractFields(packet.data, packet.length, bit_offset, out.values.data() + first_value);
 
-  if (!raw_packet.valid || raw_packet.length == 0) {
-    return result;
+  if (!node.has_next) {
+    return 0;
   }
+  return node.extractSelector(packet.data, packet.length, bit_offset, node.isInBounds(packet.length, bit_offset));
+}
 
-  std::string current_protocol_path = protocol_entry_file_;
-  uint32_t current_bit_offset = 0;
+uint64_t PacketParser::skimLayer(const PacketView& packet, const ProtocolNode& node, uint32_t bit_offset,
+                                 ParsedPacket& out) {
+  size_t first_value = out.values.size();
+  out.pending_layers |= uint32_t{1} << out.layers.size();
+  out.layers.push_back({node.id, bit_offset, static_cast<uint32_t>(first_value)});
+  out.values.resize(first_value + node.fields.size());
 
-  while (!current_protocol_path.empty()) {
-    ProtocolConfig config;
-    try {
-      config = protocol_loader_.loadProtocol(current_protocol_path);
-    } catch (const std::exception& e) {
-      std::cerr << "Failed to load protocol from " << current_protocol_path << ": " << e.what() << std::endl;
-      break;
-    }
+  bool in_bounds = node.isInBounds(packet.length, bit_offset);
+  for (uint32_t index : node.chain_fields) {
+    out.values[first_value + index] = node.extractField(index, packet.data, packet.length, bit_offset, in_bounds);
+  }
 
-    ParsedProtocolLayer layer;
-    layer.file = current_protocol_path;
-    std::unordered_map<std::string, uint64_t> field_values;
+  if (!node.has_next) {
+    return 0;
+  }
+  return node.extractSelector(packet.data, packet.length, bit_offset, in_bounds);
+}
 
-    for (const auto& [offset_length, field] : config.header) {
-      uint32_t field_offset = offset_length[0] + current_bit_offset;
-      uint32_t field_length = offset_length[1];
+const ProtocolNode* PacketParser::nextLayer(const ProtocolNode& node, uint64_t selector_value, uint32_t& bit_offset,
+                                            ParsedPacket& out) {
+  if (!node.has_next) {
+    return nullptr;
+  }
+  uint32_t next_id = node.nextNode(static_cast<uint16_t>(selector_value));
+  if (next_id == NO_PROTOCOL_NODE) {
+    return nullptr;
+  }
 
-      uint64_t value = extractBits(raw_packet.data.data(), raw_packet.length, field_offset, field_length);
+  bit_offset += evaluateStartAfter(node, out.values.data() + out.layers.back().first_value);
+  return &graph_->node(next_id);
+}
 
-      std::string relative_key = std::to_string(offset_length[0]) + "_" + std::to_string(offset_length[1]);
-      std::string absolute_key = relative_key + "_" + std::to_string(field_offset);
-      layer.fields[absolute_key] = value;
-      field_values[relative_key] = value;
-    }
+void PacketParser::walkLayers(const PacketView& packet, const ProtocolNode* node, uint32_t bit_offset,
+                              ParsedPacket& out) {
+  while (node != nullptr && out.layers.size() < PARSER_MAX_LAYERS) {
+    uint64_t selector_value = decodeLayer(packet, *node, bit_offset, out);
+    node = nextLayer(*node, selector_value, bit_offset, out);
+  }
+}
 
-    result.layers.push_back(layer);
+bool PacketParser::beginPacket(const PacketView& packet, ParsedPacket& out) const {
+  out.clear();
+  if (out.graph != graph_) {
+    out.graph = graph_;
+  }
+  return packet.data != nullptr && packet.length != 0 && graph_;
+}
 
-    if (!config.next_protocol.has_value()) {
-      break;
-    }
+void PacketParser::parsePacket(const PacketView& packet, ParsedPacket& out) {
+  if (beginPacket(packet, out)) {
+    walkLayers(packet, graph_->entry(), 0, out);
+  }
+}
 
-    const NextProtocol& next = config.next_protocol.value();
+void PacketParser::parseChain(const PacketView& packet, ParsedPacket& out) {
+  if (!beginPacket(packet, out)) {
+    return;
+  }
 
-    size_t underscore_pos = next.selector.find('_');
-    if (underscore_pos == std::string::npos || underscore_pos == 0 || underscore_pos >= next.selector.length() - 1) {
-      break;
-    }
+  const ProtocolNode* node = graph_->entry();
+  uint32_t bit_offset = 0;
+  while (node != nullptr && out.layers.size() < PARSER_MAX_LAYERS) {
+    uint64_t selector_value = skimLayer(packet, *node, bit_offset, out);
+    node = nextLayer(*node, selector_value, bit_offset, out);
+  }
+}
 
-    uint32_t selector_offset = 0;
-    uint32_t selector_length = 0;
-    try {
-      selector_offset = std::stoul(next.selector.substr(0, underscore_pos));
-      selector_length = std::stoul(next.selector.substr(underscore_pos + 1));
-    } catch (const std::exception& e) {
-      std::cerr << "Invalid selector format: " << next.selector << " - " << e.what() << std::endl;
-      break;
+void PacketParser::parseBatch(const PacketView* packets, ParsedPacket* out, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    const PacketView& packet = packets[i];
+    if (!beginPacket(packet, out[i])) {
+      continue;
     }
 
-    uint64_t selector_value =
-        extractBits(raw_packet.data.data(), raw_packet.length, current_bit_offset + selector_offset, selector_length);
-
-    auto mapping_it = next.mappings.find(static_cast<uint16_t>(selector_value));
-    if (mapping_it == next.mappings.end()) {
-      break;
+    const ProtocolNode* node = graph_->entry();
+    uint32_t bit_offset = 0;
+    for (size_t depth = 0; node != nullptr && depth < PARSER_BATCH_GATHER_LAYERS; depth++) {
+      uint32_t layer_byte = bit_offset / 8;
+      bool gather = bit_offset % 8 == 0 && layer_byte <= packet.length &&
+                    node->gather_plan.extent_bytes <= packet.length - layer_byte;
+      uint64_t selector_value =
+          gather ? gatherLayer(packet, *node, bit_offset, out[i]) : decodeLayer(packet, *node, bit_offset, out[i]);
+      node = nextLayer(*node, selector_value, bit_offset, out[i]);
     }
+    walkLayers(packet, node, bit_offset, out[i]);
+  }
+}
 
-    uint32_t start_after = evaluateStartAfter(next.start_after, field_values);
-    current_bit_offset += start_after;
+uint64_t PacketParser::gatherLayer(const PacketView& packet, const ProtocolNode& node, uint32_t bit_offset,
+                                   ParsedPacket& out) {
+  const FieldGatherPlan& plan = node.gather_plan;
+  size_t first_value = out.values.size();
+  out.layers.push_back({node.id, bit_offset, static_cast<uint32_t>(first_value)});
+  out.values.resize(first_value + plan.size());
+
+  uint64_t* values = out.values.data() + first_value;
+  gather_kernel_(packet.data + bit_offset / 8, plan, values);
+  for (uint32_t j : plan.generic) {
+    uint32_t offset = j < node.fields.size() ? node.fields[j].offset : node.selector_offset;
+    uint32_t length = j < node.fields.size() ? node.fields[j].length : node.selector_length;
+    values[j] = extractBits(packet.data, packet.length, offset + bit_offset, length);
+  }
 
-    current_protocol_path = resolveProtocolPath(current_protocol_path, mapping_it->second);
+  if (!node.has_next) {
+    return 0;
   }
-  return result;
+  // The selector is the plan's last entry
+  uint64_t selector_value = out.values.back();
+  out.values.pop_back();
+  return selector_value;
 }
@@ -1,25 +1,55 @@
 #pragma once
 
-#include "../protocol_loader/protocol_loader.hpp"
 #include "../utils/packets/packet_model.hpp"
+#include "./field_gather.hpp"
 #include "./parser_model.hpp"
+#include "./protocol_graph.hpp"
+#include <memory>
 #include <string>
-#include <unordered_map>
+#include <vector>
 
 class PacketParser : public ParserModel {
 private:
-  ProtocolLoader protocol_loader_;
   std::string protocol_entry_file_;
+  // Compiled when the entry file is set, shared with clones
+  std::shared_ptr<const ProtocolGraph> graph_;
 
-  uint64_t extractBits(const uint8_t* data, size_t data_length, uint32_t bit_offset, uint32_t bit_length) const;
-  uint32_t evaluateStartAfter(const std::string& expression,
-                              const std::unordered_map<std::string, uint64_t>& field_values) const;
-  std::string resolveProtocolPath(const std::string& current_path, const std::string& relative_path) const;
+  // ExprTk fallback for start_after expressions the native compiler leaves alone, compiled on first use.
+  // Kept per parser since an ExprTk expression evaluates through its own bound variables.
+  struct ExprtkStartAfter;
+  std::vector<std::unique_ptr<ExprtkStartAfter>> exprtk_start_after_; // By node id
+
+  // SIMD kernel for the leading layers of parseBatch(), picked for the CPU
+  FieldGatherKernel gather_kernel_;
+
+  // Resets out for packet, false when there is nothing to decode
+  bool beginPacket(const PacketView& packet, ParsedPacket& out) const;
+  uint32_t evaluateStartAfter(const ProtocolNode& node, const uint64_t* field_values);
+  // Appends the layer of node at bit_offset, returns its selector value (0 when the node has no next protocol)
+  uint64_t decodeLayer(const PacketView& packet, const ProtocolNode& node, uint32_t bit_offset, ParsedPacket& out);
+  // decodeLayer() for a lazy parse: only the node's chain fields, the layer is left pending in out
+  uint64_t skimLayer(const PacketView& packet, const ProtocolNode& node, uint32_t bit_offset, ParsedPacket& out);
+  // Node of the layer after the last one in out, moving bit_offset to it; null when decoding stops
+  const ProtocolNode* nextLayer(const ProtocolNode& node, uint64_t selector_value, uint32_t& bit_offset,
+                                ParsedPacket& out);
+  void walkLayers(const PacketView& packet, const ProtocolNode* node, uint32_t bit_offset, ParsedPacket& out);
+  // decodeLayer() through node's gather plan and gather_kernel_, for a byte-aligned layer holding its extent
+  uint64_t gatherLayer(const PacketView& packet, const ProtocolNode& node, uint32_t bit_offset, ParsedPacket& out);
 
 public:
-  PacketParser() = default;
-  ~PacketParser() override = default;
+  PacketParser();
+  ~PacketParser() override;
 
-  ParsedPacket parsePacket(const RawPacket& raw_packet) override;
+  using ParserModel::parseBatch;
+  using ParserModel::parsePacket;
+  void parsePacket(const PacketView& packet, ParsedPacket& out) override;
+  // The first PARSER_BATCH_GATHER_LAYERS layers of each packet (L2, L3) are decoded with the SIMD gather
+  // kernel, the rest of the graph one field at a time as parsePacket() does
+  void parseBatch(const PacketView* packets, ParsedPacket* out, size_t count) override;
+  void parseChain(const PacketView& packet, ParsedPacket& out) override;
   void setProtocolEntryFile(const std::string& path) override;
+  const std::string& getProtocolEntryFile() const override;
+  // Null until an entry file is set
+  const std::shared_ptr<const ProtocolGraph>& getGraph() const { return graph_; }
+  std::unique_ptr<ParserModel> clone() const override;
 };
@@ -0,0 +1,55 @@
+#include "parsed_packet.hpp"
+
+void ParsedPacket::clear() {
+  layers.clear();
+  values.clear();
+  pending_layers = 0;
+}
+
+void ParsedPacket::decodeLayer(size_t layer, const PacketView& packet) {
+  if (isDecoded(layer)) {
+    return;
+  }
+  const ParsedLayer& parsed = layers[layer];
+  protocol(layer).extractFields(packet.data, packet.length, parsed.bit_offset, values.data() + parsed.first_value);
+  pending_layers &= ~(uint32_t{1} << layer);
+}
+
+void ParsedPacket::decodeAll(const PacketView& packet) {
+  for (size_t layer = 0; pending_layers != 0 && layer < layers.size(); layer++) {
+    decodeLayer(layer, packet);
+  }
+}
+
+bool ParsedPacket::getValue(uint32_t field_id, uint64_t& value) const {
+  if (!graph || field_id >= graph->fieldCount()) {
+    return false;
+  }
+
+  const FieldDescriptor& field = graph->field(field_id);
+  for (size_t layer = 0; layer < layers.size(); layer++) {
+    if (layers[layer].protocol_id == field.protocol_id) {
+      if (!isDecoded(layer)) {
+        return false;
+      }
+      value = values[layers[layer].first_value + field.index];
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ParsedPacket::getValue(uint32_t field_id, const PacketView& packet, uint64_t& value) {
+  if (!graph || field_id >= graph->fieldCount()) {
+    return false;
+  }
+
+  uint32_t protocol_id = graph->field(field_id).protocol_id;
+  for (size_t layer = 0; layer < layers.size(); layer++) {
+    if (layers[layer].protocol_id == protocol_id) {
+      decodeLayer(layer, packet);
+      break;
+    }
+  }
+  return getValue(field_id, value);
+}
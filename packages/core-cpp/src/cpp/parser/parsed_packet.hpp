@@ -0,0 +1,54 @@
+#pragma once
+
+#include "../utils/buffer/packet_pool.hpp"
+#include "../utils/common/common.hpp"
+#include "../utils/packets/packet_model.hpp"
+#include "./protocol_graph.hpp"
+#include <cstdint>
+#include <memory>
+#include <napi.h>
+#include <string>
+#include <vector>
+
+// One decoded layer; its field values are ProtocolNode::fields in order, starting at values[first_value]
+struct ParsedLayer {
+  uint32_t protocol_id = 0; // ProtocolNode id in the packet's graph
+  uint32_t bit_offset = 0;  // Start of the layer in the packet
+  uint32_t first_value = 0;
+};
+
+// Decoded packet as flat arrays, reused from packet to packet without reallocating. Field i of layer l is
+// field id protocol(l).fields[i].id at bit layers[l].bit_offset + fields[i].offset, holding values[first_value + i].
+// Names and "offset_length_absolute" keys come from the graph and are only built at the N-API boundary.
+// After a lazy parse (ParserModel::parseChain) the values of pending layers are not decoded yet, only the
+// ones their start_after needed; decodeLayer() fills them in from the packet bytes.
+struct ParsedPacket {
+  static_assert(PARSER_MAX_LAYERS <= 32, "pending_layers holds one bit per layer");
+
+  std::vector<ParsedLayer> layers;
+  std::vector<uint64_t> values;
+  std::shared_ptr<const ProtocolGraph> graph; // Resolves ids, set by the parser
+  uint32_t pending_layers = 0;                // Bit l set while layer l is not decoded
+
+  void clear();
+
+  const ProtocolNode& protocol(size_t layer) const { return graph->node(layers[layer].protocol_id); }
+  bool isDecoded(size_t layer) const { return (pending_layers & (uint32_t{1} << layer)) == 0; }
+  // Only complete once the layer is decoded
+  const uint64_t* layerValues(size_t layer) const { return values.data() + layers[layer].first_value; }
+  // Decodes a pending layer from the packet it was parsed from, nothing to do for a decoded one
+  void decodeLayer(size_t layer, const PacketView& packet);
+  void decodeAll(const PacketView& packet);
+  // Value of field_id (see ProtocolGraph::findField) in the first layer of its protocol, false if absent or
+  // still pending
+  bool getValue(uint32_t field_id, uint64_t& value) const;
+  // Same, decoding the layer first when needed
+  bool getValue(uint32_t field_id, const PacketView& packet, uint64_t& value);
+
+  // Every layer must be decoded
+  Napi::Array toNapiArray(Napi::Env& env) const;
+  // Pending layers become getters that decode the layer on first read, then are replaced by the plain layer
+  // object. The array keeps a reference to packet and a copy of this packet's layers until JS collects it.
+  Napi::Array toNapiArray(Napi::Env& env, const PacketRef& packet) const;
+  Napi::Object layerToNapiObject(Napi::Env& env, size_t layer) const;
+};
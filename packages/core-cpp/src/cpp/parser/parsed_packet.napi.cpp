@@ -0,0 +1,96 @@
+#include "parsed_packet.hpp"
+#include <string>
+#include <vector>
+
+namespace {
+
+// What the getters of a lazy N-API array read, owned by the array
+struct LazyNapiPacket {
+  struct Slot {
+    LazyNapiPacket* owner;
+    uint32_t layer;
+  };
+
+  PacketRef packet;
+  ParsedPacket parsed;
+  std::vector<Slot> slots; // One per pending layer, passed to its getter
+};
+
+Napi::Value getLazyLayer(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  auto* slot = static_cast<LazyNapiPacket::Slot*>(info.Data());
+  LazyNapiPacket& lazy = *slot->owner;
+
+  lazy.parsed.decodeLayer(slot->layer, lazy.packet.view());
+  Napi::Object layer = lazy.parsed.layerToNapiObject(env, slot->layer);
+
+  // Later reads get the plain object
+  info.This().As<Napi::Object>().DefineProperty(Napi::PropertyDescriptor::Value(
+      std::to_string(slot->layer), layer,
+      static_cast<napi_property_attributes>(napi_writable | napi_enumerable | napi_configurable)));
+  return layer;
+}
+
+} // namespace
+
+Napi::Array ParsedPacket::toNapiArray(Napi::Env& env) const {
+  Napi::Array result = Napi::Array::New(env, layers.size());
+  for (size_t i = 0; i < layers.size(); i++) {
+    result.Set(i, layerToNapiObject(env, i));
+  }
+  return result;
+}
+
+Napi::Array ParsedPacket::toNapiArray(Napi::Env& env, const PacketRef& packet) const {
+  if (pending_layers == 0) {
+    return toNapiArray(env);
+  }
+
+  Napi::Array result = Napi::Array::New(env, layers.size());
+  auto* lazy = new LazyNapiPacket{packet, *this, {}};
+  lazy->slots.reserve(layers.size());
+
+  std::vector<std::string> names;
+  names.reserve(layers.size());
+  std::vector<Napi::PropertyDescriptor> getters;
+  for (size_t i = 0; i < layers.size(); i++) {
+    if (isDecoded(i)) {
+      result.Set(i, layerToNapiObject(env, i));
+      continue;
+    }
+    lazy->slots.push_back({lazy, static_cast<uint32_t>(i)});
+    names.push_back(std::to_string(i));
+    getters.push_back(Napi::PropertyDescriptor::Accessor<getLazyLayer>(
+        names.back().c_str(), static_cast<napi_property_attributes>(napi_enumerable | napi_configurable),
+        &lazy->slots.back()));
+  }
+
+  result.DefineProperties(getters);
+  result.AddFinalizer([](Napi::Env, LazyNapiPacket* data) { delete data; }, lazy);
+  return result;
+}
+
+Napi::Object ParsedPacket::layerToNapiObject(Napi::Env& env, size_t layer) const {
+  const ProtocolNode& node = protocol(layer);
+  const uint64_t* layer_values = layerValues(layer);
+  Napi::Object layer_obj = Napi::Object::New(env);
+
+  for (size_t f = 0; f < node.fields.size(); f++) {
+    const FieldDescriptor& field = node.fields[f];
+    std::string key = field.key + "_" + std::to_string(field.offset + layers[layer].bit_offset);
+    uint64_t value = layer_values[f];
+
+    if (value <= 0xFFFFFFFF) {
+      layer_obj.Set(key, Napi::Number::New(env, static_cast<double>(value)));
+    } else {
+      layer_obj.Set(key, Napi::String::New(env, std::to_string(value)));
+    }
+  }
+
+  if (!node.file.empty()) {
+    layer_obj.Set("file", Napi::String::New(env, node.file));
+  } else {
+    layer_obj.Set("file", env.Null());
+  }
+  return layer_obj;
+}
@@ -1,48 +1,49 @@
 #pragma once
 
 #include "../utils/packets/packet_model.hpp"
-#include <napi.h>
+#include "./parsed_packet.hpp"
+#include <memory>
 #include <string>
-#include <unordered_map>
-#include <vector>
 
-struct ParsedProtocolLayer {
-  std::string file;
-  std::unordered_map<std::string, uint64_t> fields;
-};
-
-struct ParsedPacket {
-  std::vector<ParsedProtocolLayer> layers;
-  Napi::Array toNapiArray(Napi::Env& env) const {
-    Napi::Array result = Napi::Array::New(env, layers.size());
-
-    for (size_t i = 0; i < layers.size(); i++) {
-      const ParsedProtocolLayer& layer = layers[i];
-      Napi::Object layer_obj = Napi::Object::New(env);
-
-      for (const auto& [key, value] : layer.fields) {
-        if (value <= 0xFFFFFFFF) {
-          layer_obj.Set(key, Napi::Number::New(env, static_cast<double>(value)));
-        } else {
-          layer_obj.Set(key, Napi::String::New(env, std::to_string(value)));
-        }
-      }
-
-      if (!layer.file.empty()) {
-        layer_obj.Set("file", Napi::String::New(env, layer.file));
-      } else {
-        layer_obj.Set("file", env.Null());
-      }
-      result.Set(i, layer_obj);
-    }
-
-    return result;
-  }
-};
+// Eager decodes every field while parsing; Lazy only records the layer chain, see ParserModel::parseChain()
+enum class ParseMode { Eager, Lazy };
 
 class ParserModel {
 public:
   virtual ~ParserModel() = default;
-  virtual ParsedPacket parsePacket(const RawPacket& raw_packet) = 0;
+  // Reads the packet in place, the view only has to stay valid for the duration of the call.
+  // Overwrites out, reusing its storage, so a caller that keeps one ParsedPacket per slot stops allocating.
+  virtual void parsePacket(const PacketView& packet, ParsedPacket& out) = 0;
+  ParsedPacket parsePacket(const PacketView& packet) {
+    ParsedPacket result;
+    parsePacket(packet, result);
+    return result;
+  }
+  ParsedPacket parsePacket(const RawPacket& raw_packet) { return parsePacket(raw_packet.view()); }
+  // Parses packets[i] into out[i], with the same results as parsePacket() on each. Parsers that can share work
+  // across packets override it.
+  virtual void parseBatch(const PacketView* packets, ParsedPacket* out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+      parsePacket(packets[i], out[i]);
+    }
+  }
+  // Lazy parse: the layers of the packet with only the fields needed to find the next one decoded. The others
+  // are decoded on demand by ParsedPacket::decodeLayer() from the same bytes. Parsers without a lazy mode
+  // decode everything.
+  virtual void parseChain(const PacketView& packet, ParsedPacket& out) { parsePacket(packet, out); }
+  // parseBatch(), or parseChain() on each packet in ParseMode::Lazy
+  void parseBatch(const PacketView* packets, ParsedPacket* out, size_t count, ParseMode mode) {
+    if (mode == ParseMode::Lazy) {
+      for (size_t i = 0; i < count; i++) {
+        parseChain(packets[i], out[i]);
+      }
+    } else {
+      parseBatch(packets, out, count);
+    }
+  }
   virtual void setProtocolEntryFile(const std::string& path) = 0;
+  virtual const std::string& getProtocolEntryFile() const = 0;
+
+  // Fresh parser with the same configuration, one per worker thread since parsers keep per-instance state
+  virtual std::unique_ptr<ParserModel> clone() const = 0;
 };
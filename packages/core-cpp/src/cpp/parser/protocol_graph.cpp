@@ -0,0 +1,240 @@
+#include "protocol_graph.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Mapped files are relative to the file that maps them
+std::string resolveProtocolPath(const std::string& current_path, const std::string& relative_path) {
+  fs::path parent = fs::path(current_path).parent_path();
+  return (parent / relative_path).lexically_normal().string();
+}
+
+// "offset_length" selector, false when malformed
+bool parseSelector(const std::string& selector, uint32_t& offset, uint32_t& length) {
+  size_t underscore_pos = selector.find('_');
+  if (underscore_pos == std::string::npos || underscore_pos == 0 || underscore_pos >= selector.length() - 1) {
+    return false;
+  }
+
+  try {
+    offset = std::stoul(selector.substr(0, underscore_pos));
+    length = std::stoul(selector.substr(underscore_pos + 1));
+  } catch (const std::exception&) {
+    return false;
+  }
+  return true;
+}
+
+} // namespace
+
+uint32_t ProtocolNode::nextNode(uint16_t selector_value) const {
+  auto it = std::lower_bound(next_nodes.begin(), next_nodes.end(), selector_value,
+                             [](const std::pair<uint16_t, uint32_t>& entry, uint16_t value) { return entry.first < value; });
+  if (it == next_nodes.end() || it->first != selector_value) {
+    return NO_PROTOCOL_NODE;
+  }
+  return it->second;
+}
+
+void ProtocolNode::extractFields(const uint8_t* data, size_t length, uint32_t bit_offset, uint64_t* values) const {
+  bool in_bounds = isInBounds(length, bit_offset);
+  for (size_t i = 0; i < fields.size(); i++) {
+    values[i] = extractField(i, data, length, bit_offset, in_bounds);
+  }
+}
+
+uint64_t ProtocolNode::extractField(size_t index, const uint8_t* data, size_t length, uint32_t bit_offset,
+                                    bool in_bounds) const {
+  const FieldDescriptor& field = fields[index];
+  return in_bounds ? field.extractor.extract(data + bit_offset / 8)
+                   : extractBits(data, length, field.offset + bit_offset, field.length);
+}
+
+uint64_t ProtocolNode::extractSelector(const uint8_t* data, size_t length, uint32_t bit_offset, bool in_bounds) const {
+  return in_bounds ? selector.extract(data + bit_offset / 8)
+                   : extractBits(data, length, bit_offset + selector_offset, selector_length);
+}
+
+std::shared_ptr<const ProtocolGraph> ProtocolGraph::build(const std::string& entry_file) {
+  auto graph = std::make_shared<ProtocolGraph>();
+  graph->entry_file_ = entry_file;
+  if (entry_file.empty()) {
+    return graph;
+  }
+
+  ProtocolLoader loader;
+  std::vector<ProtocolConfig> configs;
+  std::unordered_map<std::string, uint32_t> ids; // Resolved path to node id, NO_PROTOCOL_NODE if it failed to load
+
+  auto addNode = [&](const std::string& path) {
+    auto it = ids.find(path);
+    if (it != ids.end()) {
+      return it->second;
+    }
+
+    ProtocolConfig config;
+    try {
+      config = loader.loadProtocol(path);
+    } catch (const std::exception& e) {
+      std::cerr << "Failed to load protocol from " << path << ": " << e.what() << std::endl;
+      ids[path] = NO_PROTOCOL_NODE;
+      return NO_PROTOCOL_NODE;
+    }
+
+    ProtocolNode node;
+    node.id = static_cast<uint32_t>(graph->nodes_.size());
+    node.file = path;
+    node.name = config.name;
+    for (const auto& [offset_length, field] : config.header) {
+      FieldDescriptor descriptor;
+      descriptor.offset = offset_length[0];
+      descriptor.length = offset_length[1];
+      descriptor.key = std::to_string(offset_length[0]) + "_" + std::to_string(offset_length[1]);
+      descriptor.extractor = BitExtractor::select(descriptor.offset, descriptor.length);
+      node.extent_bytes = std::max(node.extent_bytes, descriptor.extractor.getEndByte());
+      node.fields.push_back(std::move(descriptor));
+    }
+    std::sort(node.fields.begin(), node.fields.end(), [](const FieldDescriptor& a, const FieldDescriptor& b) {
+      return a.offset != b.offset ? a.offset < b.offset : a.length < b.length;
+    });
+
+    ids[path] = node.id;
+    graph->nodes_.push_back(std::move(node));
+    configs.push_back(std::move(config));
+    return graph->nodes_.back().id;
+  };
+
+  addNode(entry_file);
+
+  // Breadth first, nodes_ grows while mappings are followed
+  for (size_t i = 0; i < graph->nodes_.size(); i++) {
+    if (!configs[i].next_protocol.has_value()) {
+      continue;
+    }
+    // A copy, following the mappings below grows configs
+    NextProtocol next = configs[i].next_protocol.value();
+
+    uint32_t selector_offset = 0;
+    uint32_t selector_length = 0;
+    if (!parseSelector(next.selector, selector_offset, selector_length)) {
+      std::cerr << "Invalid selector format: " << next.selector << " in " << graph->nodes_[i].file << std::endl;
+      continue;
+    }
+
+    std::vector<std::pair<uint16_t, uint32_t>> next_nodes;
+    std::string current_file = graph->nodes_[i].file;
+    for (const auto& [value, file] : next.mappings) {
+      uint32_t next_id = addNode(resolveProtocolPath(current_file, file));
+      if (next_id != NO_PROTOCOL_NODE) {
+        next_nodes.emplace_back(value, next_id);
+      }
+    }
+    std::sort(next_nodes.begin(), next_nodes.end());
+
+    ProtocolNode& node = graph->nodes_[i];
+    node.has_next = true;
+    node.selector_offset = selector_offset;
+    node.selector_length = selector_length;
+    node.selector = BitExtractor::select(selector_offset, selector_length);
+    node.extent_bytes = std::max(node.extent_bytes, node.selector.getEndByte());
+    node.start_after = StartAfter::compile(next.start_after, [&node](uint32_t offset, uint32_t length) {
+      for (size_t field = 0; field < node.fields.size(); field++) {
+        if (node.fields[field].offset == offset && node.fields[field].length == length) {
+          return static_cast<int>(field);
+        }
+      }
+      return -1;
+    });
+    node.next_nodes = std::move(next_nodes);
+
+    const std::vector<StartAfter::Op>& program = node.start_after.getProgram();
+    for (uint32_t field = 0; field < node.fields.size(); field++) {
+      bool loaded = std::any_of(program.begin(), program.end(), [field](const StartAfter::Op& op) {
+        return op.code == StartAfter::Op::Load && op.field == field;
+      });
+      // The ExprTk fallback binds every field
+      if (loaded || !node.start_after.isNative()) {
+        node.chain_fields.push_back(field);
+      }
+    }
+  }
+
+  for (ProtocolNode& node : graph->nodes_) {
+    for (const FieldDescriptor& field : node.fields) {
+      node.gather_plan.add(field.extractor);
+    }
+    if (node.has_next) {
+      node.gather_plan.add(node.selector);
+    }
+  }
+
+  // Field ids once nodes_ stops growing, consecutive within a node
+  for (ProtocolNode& node : graph->nodes_) {
+    for (size_t index = 0; index < node.fields.size(); index++) {
+      FieldDescriptor& field = node.fields[index];
+      field.id = static_cast<uint32_t>(graph->fields_.size());
+      field.protocol_id = node.id;
+      field.index = static_cast<uint32_t>(index);
+      graph->fields_.push_back(&field);
+    }
+  }
+
+  return graph;
+}
+
+const ProtocolNode* ProtocolGraph::entry() const {
+  return nodes_.empty() ? nullptr : &nodes_[0];
+}
+
+uint32_t ProtocolGraph::findField(const std::string& protocol, uint32_t offset, uint32_t length) const {
+  for (const ProtocolNode& node : nodes_) {
+    if (node.name != protocol) {
+      continue;
+    }
+    for (const FieldDescriptor& field : node.fields) {
+      if (field.offset == offset && field.length == length) {
+        return field.id;
+      }
+    }
+  }
+  return NO_PROTOCOL_FIELD;
+}
+
+std::string ProtocolGraph::getSignature() const {
+  std::ostringstream out;
+  out << std::hexfloat;
+  for (const ProtocolNode& node : nodes_) {
+    out << "node " << node.id << ' ' << node.name << '\n';
+    for (const FieldDescriptor& field : node.fields) {
+      out << "field " << field.offset << ' ' << field.length << '\n';
+    }
+    if (!node.has_next) {
+      continue;
+    }
+
+    out << "selector " << node.selector_offset << ' ' << node.selector_length << '\n';
+    if (!node.start_after.isNative()) {
+      out << "start_after expression " << node.start_after.getExpression() << '\n';
+    } else if (node.start_after.isConstant()) {
+      out << "start_after " << node.start_after.getConstant() << '\n';
+    } else {
+      out << "start_after program";
+      for (const StartAfter::Op& op : node.start_after.getProgram()) {
+        out << ' ' << static_cast<int>(op.code) << ':' << (op.code == StartAfter::Op::Load ? op.field : 0) << ':'
+            << (op.code == StartAfter::Op::Push ? op.value : 0.0);
+      }
+      out << '\n';
+    }
+    for (const auto& [value, next_id] : node.next_nodes) {
+      out << "next " << value << ' ' << next_id << '\n';
+    }
+  }
+  return out.str();
+}
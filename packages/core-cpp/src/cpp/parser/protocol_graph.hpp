@@ -0,0 +1,93 @@
+#pragma once
+
+#include "../protocol_loader/protocol_loader.hpp"
+#include "./bit_extractor.hpp"
+#include "./field_gather.hpp"
+#include "./start_after.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+constexpr uint32_t NO_PROTOCOL_NODE = UINT32_MAX;
+constexpr uint32_t NO_PROTOCOL_FIELD = UINT32_MAX;
+
+// One header field, offset relative to the start of its layer
+struct FieldDescriptor {
+  uint32_t id = 0;          // Unique within the graph, assigned when it is built
+  uint32_t protocol_id = 0; // Node holding the field
+  uint32_t index = 0;       // Position in that node's fields
+  uint32_t offset = 0;
+  uint32_t length = 0;
+  std::string key; // "offset_length", as written in the protocol file
+  BitExtractor extractor;
+};
+
+// One protocol file with everything the parser needs per packet already resolved
+struct ProtocolNode {
+  uint32_t id = 0;
+  std::string file; // Resolved path, reported as the layer's file
+  std::string name;
+  std::vector<FieldDescriptor> fields; // Sorted by offset, then length
+  // Bytes the extractors of the fields and selector read; a byte-aligned layer with that many bytes left
+  // is decoded without per-field bounds checks
+  uint32_t extent_bytes = 0;
+  // The fields, then the selector when has_next, for the SIMD kernels of PacketParser::parseBatch()
+  FieldGatherPlan gather_plan;
+
+  // Next layer selection, has_next is false when the file has no usable next_protocol
+  bool has_next = false;
+  uint32_t selector_offset = 0;
+  uint32_t selector_length = 0;
+  BitExtractor selector;
+  StartAfter start_after; // Field references index into fields
+  std::vector<uint32_t> chain_fields; // Fields start_after reads, all that a lazy parse decodes before a field is read
+  std::vector<std::pair<uint16_t, uint32_t>> next_nodes; // Selector value to node id, sorted by value
+
+  // Node following this one for a selector value, NO_PROTOCOL_NODE when the value is not mapped
+  uint32_t nextNode(uint16_t selector_value) const;
+
+  // Whether a layer at bit_offset of a length-byte packet can be read by the extractors without bounds checks
+  bool isInBounds(size_t length, uint32_t bit_offset) const {
+    uint32_t layer_byte = bit_offset / 8;
+    return bit_offset % 8 == 0 && layer_byte <= length && extent_bytes <= length - layer_byte;
+  }
+  // Every field of the layer at bit_offset into values, in fields order; bounds checked once for the layer,
+  // bit by bit when it is truncated or unaligned
+  void extractFields(const uint8_t* data, size_t length, uint32_t bit_offset, uint64_t* values) const;
+  uint64_t extractField(size_t index, const uint8_t* data, size_t length, uint32_t bit_offset, bool in_bounds) const;
+  uint64_t extractSelector(const uint8_t* data, size_t length, uint32_t bit_offset, bool in_bounds) const;
+};
+
+// The protocol files reachable from an entry file, loaded, resolved and linked once. Immutable once built,
+// so the parsers of a session share one graph.
+class ProtocolGraph {
+public:
+  // Follows every mapping from the entry file. A file that fails to load is reported once and its mappings
+  // are dropped, so packets stop at the layer before it as they did when files were loaded per packet.
+  static std::shared_ptr<const ProtocolGraph> build(const std::string& entry_file);
+
+  ProtocolGraph() = default;
+  // fields_ points into nodes_
+  ProtocolGraph(const ProtocolGraph&) = delete;
+  ProtocolGraph& operator=(const ProtocolGraph&) = delete;
+
+  // Null when the entry file could not be loaded
+  const ProtocolNode* entry() const;
+  const ProtocolNode& node(uint32_t id) const { return nodes_[id]; }
+  size_t size() const { return nodes_.size(); }
+  const FieldDescriptor& field(uint32_t id) const { return *fields_[id]; }
+  size_t fieldCount() const { return fields_.size(); }
+  // Id of a protocol's "offset_length" field, protocol being the name in its file; NO_PROTOCOL_FIELD if unknown
+  uint32_t findField(const std::string& protocol, uint32_t offset, uint32_t length) const;
+  const std::string& getEntryFile() const { return entry_file_; }
+  // Canonical text of everything parsing depends on (node ids and names, fields, selectors, start_after, mappings)
+  // but not file paths, so graphs built from copies of the same files compare equal
+  std::string getSignature() const;
+
+private:
+  std::string entry_file_;
+  std::vector<ProtocolNode> nodes_;            // Indexed by id, the entry file is node 0
+  std::vector<const FieldDescriptor*> fields_; // Indexed by field id, into nodes_
+};
@@ -0,0 +1,246 @@
+#include "start_after.hpp"
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+
+namespace {
+
+using Op = StartAfter::Op;
+
+// Recursive descent over + - * / %, unary minus and parentheses, emitting postfix ops
+class ExpressionCompiler {
+public:
+  ExpressionCompiler(const std::string& text, const StartAfter::FieldIndex& field_index, size_t max_depth)
+      : text_(text), field_index_(field_index), max_depth_(max_depth) {}
+
+  bool compile(std::vector<Op>& program) {
+    if (!parseSum()) {
+      return false;
+    }
+    skipSpaces();
+    if (pos_ != text_.size()) {
+      return false;
+    }
+    program = std::move(program_);
+    return true;
+  }
+
+  bool hasLoads() const { return has_loads_; }
+
+private:
+  const std::string& text_;
+  const StartAfter::FieldIndex& field_index_;
+  const size_t max_depth_;
+  size_t pos_ = 0;
+  size_t depth_ = 0;
+  bool has_loads_ = false;
+  std::vector<Op> program_;
+
+  void skipSpaces() {
+    while (pos_ < text_.size() && std::isspace(static_cast<unsigned char>(text_[pos_]))) {
+      pos_++;
+    }
+  }
+
+  char peek() {
+    skipSpaces();
+    return pos_ < text_.size() ? text_[pos_] : '\0';
+  }
+
+  bool emit(Op op) {
+    if (op.code == Op::Push || op.code == Op::Load) {
+      depth_++;
+    } else if (op.code != Op::Negate) {
+      depth_--;
+    }
+    program_.push_back(op);
+    return depth_ <= max_depth_;
+  }
+
+  bool parseSum() {
+    if (!parseProduct()) {
+      return false;
+    }
+    while (peek() == '+' || peek() == '-') {
+      Op::Code code = text_[pos_++] == '+' ? Op::Add : Op::Subtract;
+      if (!parseProduct() || !emit({code})) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool parseProduct() {
+    if (!parseUnary()) {
+      return false;
+    }
+    while (peek() == '*' || peek() == '/' || peek() == '%') {
+      char symbol = text_[pos_++];
+      Op::Code code = symbol == '*' ? Op::Multiply : symbol == '/' ? Op::Divide : Op::Modulo;
+      if (!parseUnary() || !emit({code})) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool parseUnary() {
+    if (peek() == '-') {
+      pos_++;
+      return parseUnary() && emit({Op::Negate});
+    }
+    if (peek() == '+') {
+      pos_++;
+      return parseUnary();
+    }
+    return parsePrimary();
+  }
+
+  bool parsePrimary() {
+    char c = peek();
+
+    if (c == '(') {
+      pos_++;
+      if (!parseSum() || peek() != ')') {
+        return false;
+      }
+      pos_++;
+      return true;
+    }
+
+    if (c == '[') {
+      // [offset_length], a field of this layer; one the header does not define reads as 0
+      uint32_t offset = 0;
+      uint32_t length = 0;
+      if (!parseNumber(++pos_, offset) || text_[pos_] != '_' || !parseNumber(++pos_, length) || text_[pos_] != ']') {
+        return false;
+      }
+      pos_++;
+      int index = field_index_(offset, length);
+      if (index < 0) {
+        return emit({Op::Push, 0, 0});
+      }
+      has_loads_ = true;
+      return emit({Op::Load, static_cast<uint32_t>(index), 0});
+    }
+
+    if (std::isdigit(static_cast<unsigned char>(c)) || c == '.') {
+      const char* start = text_.c_str() + pos_;
+      char* end = nullptr;
+      double value = std::strtod(start, &end);
+      if (end == start) {
+        return false;
+      }
+      pos_ += end - start;
+      return emit({Op::Push, 0, value});
+    }
+
+    return false;
+  }
+
+  // Decimal digits at position, advances past them
+  bool parseNumber(size_t& position, uint32_t& value) {
+    size_t start = position;
+    value = 0;
+    while (position < text_.size() && std::isdigit(static_cast<unsigned char>(text_[position]))) {
+      value = value * 10 + static_cast<uint32_t>(text_[position++] - '0');
+    }
+    return position > start && position < text_.size();
+  }
+};
+
+} // namespace
+
+StartAfter StartAfter::compile(const std::string& text, const FieldIndex& field_index) {
+  StartAfter result;
+  if (text.empty()) {
+    return result;
+  }
+
+  if (text.find("calculate:") != 0) {
+    try {
+      result.constant_ = static_cast<uint32_t>(std::stoul(text));
+    } catch (...) {
+      result.constant_ = 0;
+    }
+    return result;
+  }
+
+  std::string expression = text.substr(10);
+  expression.erase(0, expression.find_first_not_of(' '));
+  if (expression.empty()) {
+    return result;
+  }
+
+  ExpressionCompiler compiler(expression, field_index, MAX_STACK_DEPTH);
+  if (!compiler.compile(result.program_)) {
+    result.kind_ = Kind::Expression;
+    result.expression_ = expression;
+    return result;
+  }
+
+  result.kind_ = Kind::Program;
+  if (!compiler.hasLoads()) {
+    // Only literals, fold it
+    result.constant_ = result.evaluate(nullptr);
+    result.kind_ = Kind::Constant;
+    result.program_.clear();
+  }
+  return result;
+}
+
+uint32_t StartAfter::evaluate(const uint64_t* field_values) const {
+  if (kind_ != Kind::Program) {
+    return constant_;
+  }
+
+  double stack[MAX_STACK_DEPTH];
+  size_t top = 0;
+
+  for (const Op& op : program_) {
+    switch (op.code) {
+    case Op::Push:
+      stack[top++] = op.value;
+      break;
+    case Op::Load:
+      stack[top++] = static_cast<double>(field_values[op.field]);
+      break;
+    case Op::Negate:
+      stack[top - 1] = -stack[top - 1];
+      break;
+    default: {
+      double right = stack[--top];
+      double& left = stack[top - 1];
+      switch (op.code) {
+      case Op::Add:
+        left += right;
+        break;
+      case Op::Subtract:
+        left -= right;
+        break;
+      case Op::Multiply:
+        left *= right;
+        break;
+      case Op::Divide:
+        left /= right;
+        break;
+      default:
+        left = std::fmod(left, right);
+        break;
+      }
+    }
+    }
+  }
+
+  return toBits(stack[0]);
+}
+
+uint32_t StartAfter::toBits(double value) {
+  if (!(value >= 0) || std::isinf(value)) {
+    return 0;
+  }
+  if (value >= 4294967295.0) {
+    return UINT32_MAX;
+  }
+  return static_cast<uint32_t>(value);
+}
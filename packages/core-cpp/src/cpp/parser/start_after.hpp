@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Bits from the start of a layer to the start of the next one, compiled once from a protocol file's start_after:
+// either a number, or "calculate:" arithmetic over the layer's fields such as "[4_4] * 4 * 8".
+// Arithmetic (+ - * / %, unary minus, parentheses) becomes a small stack program evaluated in double precision,
+// as ExprTk did; anything else is left to the caller's ExprTk fallback.
+class StartAfter {
+public:
+  // Maps an [offset_length] reference to the index of that field's value, -1 when the layer has no such field
+  using FieldIndex = std::function<int(uint32_t offset, uint32_t length)>;
+
+  static StartAfter compile(const std::string& text, const FieldIndex& field_index);
+
+  bool isConstant() const { return kind_ == Kind::Constant; }
+  // False when the expression needs ExprTk, see getExpression()
+  bool isNative() const { return kind_ != Kind::Expression; }
+  uint32_t getConstant() const { return constant_; }
+  // Runs the native program over the layer's field values, indexed as FieldIndex returned them
+  uint32_t evaluate(const uint64_t* field_values) const;
+  // Expression body after "calculate:", for the ExprTk fallback
+  const std::string& getExpression() const { return expression_; }
+
+  // Clamps an expression result to a bit count: negative, NaN and infinite results are 0
+  static uint32_t toBits(double value);
+
+  struct Op {
+    enum Code : uint8_t { Push, Load, Add, Subtract, Multiply, Divide, Modulo, Negate } code;
+    uint32_t field = 0; // Load: index into the field values
+    double value = 0;   // Push
+  };
+  const std::vector<Op>& getProgram() const { return program_; }
+
+private:
+  static constexpr size_t MAX_STACK_DEPTH = 16;
+
+  enum class Kind { Constant, Program, Expression };
+  Kind kind_ = Kind::Constant;
+  uint32_t constant_ = 0;
+  std::vector<Op> program_;
+  std::string expression_;
+};
@@ -26,6 +26,7 @@ ProtocolConfig ProtocolLoader::parseProtocolJson(const json& j) {
 
         ProtocolField field;
         field.description = field_data.at("description").get<std::string>();
+        field.type = field_data.value("type", "");
         config.header[{offset, length}] = field;
     }
 
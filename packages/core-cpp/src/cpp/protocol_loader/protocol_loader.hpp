@@ -8,6 +8,7 @@
 
 struct ProtocolField {
     std::string description;
+    std::string type;
 };
 
 struct NextProtocol {
@@ -0,0 +1,743 @@
+#include "filter_compiler.hpp"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cctype>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Any on a field means it has no source/destination role and is never used by host/net/port
+enum class Direction { Any, Source, Destination };
+
+struct FilterNode {
+  enum class Kind { And, Or, Not, Tests };
+
+  Kind kind = Kind::Tests;
+  std::vector<FilterFieldTest> tests; // Kind::Tests, all must hold (empty always matches)
+  std::unique_ptr<FilterNode> left;
+  std::unique_ptr<FilterNode> right;
+};
+
+using FilterNodePtr = std::unique_ptr<FilterNode>;
+
+FilterNodePtr makeTests(std::vector<FilterFieldTest> tests) {
+  auto node = std::make_unique<FilterNode>();
+  node->kind = FilterNode::Kind::Tests;
+  node->tests = std::move(tests);
+  return node;
+}
+
+FilterNodePtr makeBinary(FilterNode::Kind kind, FilterNodePtr left, FilterNodePtr right) {
+  if (!left) return right;
+  if (!right) return left;
+
+  auto node = std::make_unique<FilterNode>();
+  node->kind = kind;
+  node->left = std::move(left);
+  node->right = std::move(right);
+  return node;
+}
+
+FilterNodePtr makeNot(FilterNodePtr operand) {
+  auto node = std::make_unique<FilterNode>();
+  node->kind = FilterNode::Kind::Not;
+  node->left = std::move(operand);
+  return node;
+}
+
+std::string toLower(std::string value) {
+  std::transform(value.begin(), value.end(), value.begin(), [](unsigned char c) { return std::tolower(c); });
+  return value;
+}
+
+bool parseOffsetLength(const std::string& key, uint32_t& offset, uint32_t& length) {
+  int consumed = 0;
+  if (std::sscanf(key.c_str(), "%u_%u%n", &offset, &length, &consumed) != 2) {
+    return false;
+  }
+  return static_cast<size_t>(consumed) == key.size();
+}
+
+Direction fieldDirection(const std::string& description) {
+  if (description.find("Source") != std::string::npos || description.find("Sender") != std::string::npos) {
+    return Direction::Source;
+  }
+  if (description.find("Destination") != std::string::npos || description.find("Target") != std::string::npos) {
+    return Direction::Destination;
+  }
+  return Direction::Any;
+}
+
+bool directionMatches(Direction wanted, Direction field) {
+  if (field == Direction::Any) return false;
+  return wanted == Direction::Any || wanted == field;
+}
+
+// Header fields sorted by offset so generated programs are deterministic
+std::vector<std::pair<std::array<uint32_t, 2>, ProtocolField>> sortedFields(const ProtocolConfig& config) {
+  std::vector<std::pair<std::array<uint32_t, 2>, ProtocolField>> fields(config.header.begin(), config.header.end());
+  std::sort(fields.begin(), fields.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+  return fields;
+}
+
+// Splits a byte-aligned field into <= 32-bit tests against value, honouring a prefix length in bits
+std::vector<FilterFieldTest> valueTests(const FilterLocation& location, uint32_t bit_offset,
+                                        const std::vector<uint8_t>& value, uint32_t prefix_bits) {
+  std::vector<FilterFieldTest> tests;
+  uint32_t total_bits = static_cast<uint32_t>(value.size() * 8);
+
+  for (uint32_t chunk = 0; chunk < total_bits; chunk += 32) {
+    uint32_t width = std::min<uint32_t>(32, total_bits - chunk);
+    uint32_t covered = prefix_bits > chunk ? std::min(width, prefix_bits - chunk) : 0;
+    if (covered == 0) {
+      break;
+    }
+
+    uint32_t chunk_value = 0;
+    for (uint32_t byte = chunk / 8; byte < (chunk + width) / 8; byte++) {
+      chunk_value = (chunk_value << 8) | value[byte];
+    }
+
+    uint32_t full_mask = width == 32 ? 0xffffffff : ((1u << width) - 1);
+    uint32_t host_bits = width - covered;
+    uint32_t mask = host_bits == 0 ? full_mask : full_mask & ~((host_bits == 32 ? 0xffffffff : (1u << host_bits) - 1));
+
+    FilterFieldTest test;
+    test.location = location;
+    test.bit_offset = bit_offset + chunk;
+    test.bit_length = width;
+    test.mask = mask;
+    test.value = chunk_value & mask;
+    tests.push_back(test);
+  }
+
+  return tests;
+}
+
+class FilterParser {
+public:
+  FilterParser(const std::vector<FilterProtocol>& protocols, const std::unordered_map<std::string, size_t>& keywords,
+               const std::string& expression)
+      : protocols_(protocols), keywords_(keywords), pos_(0) {
+    tokenize(expression);
+  }
+
+  FilterNodePtr parse() {
+    FilterNodePtr root = parseOr();
+    if (pos_ < tokens_.size()) {
+      throw std::runtime_error("Unexpected '" + tokens_[pos_] + "' in capture filter");
+    }
+    return root;
+  }
+
+private:
+  const std::vector<FilterProtocol>& protocols_;
+  const std::unordered_map<std::string, size_t>& keywords_;
+  std::vector<std::string> tokens_;
+  size_t pos_;
+
+  void tokenize(const std::string& expression) {
+    size_t i = 0;
+    while (i < expression.size()) {
+      char c = expression[i];
+      if (std::isspace(static_cast<unsigned char>(c))) {
+        i++;
+      } else if (c == '(' || c == ')' || c == '!') {
+        tokens_.emplace_back(1, c);
+        i++;
+      } else if ((c == '&' || c == '|') && i + 1 < expression.size() && expression[i + 1] == c) {
+        tokens_.push_back(c == '&' ? "and" : "or");
+        i += 2;
+      } else {
+        size_t start = i;
+        while (i < expression.size() && !std::isspace(static_cast<unsigned char>(expression[i])) &&
+               expression[i] != '(' && expression[i] != ')') {
+          i++;
+        }
+        tokens_.push_back(expression.substr(start, i - start));
+      }
+    }
+  }
+
+  bool atEnd() const { return pos_ >= tokens_.size(); }
+
+  std::string peekLower() const { return atEnd() ? "" : toLower(tokens_[pos_]); }
+
+  std::string next(const char* expected) {
+    if (atEnd()) {
+      throw std::runtime_error(std::string("Capture filter ended early, expected ") + expected);
+    }
+    return tokens_[pos_++];
+  }
+
+  FilterNodePtr parseOr() {
+    FilterNodePtr node = parseAnd();
+    while (peekLower() == "or") {
+      pos_++;
+      node = makeBinary(FilterNode::Kind::Or, std::move(node), parseAnd());
+    }
+    return node;
+  }
+
+  FilterNodePtr parseAnd() {
+    FilterNodePtr node = parseFactor();
+    while (peekLower() == "and") {
+      pos_++;
+      node = makeBinary(FilterNode::Kind::And, std::move(node), parseFactor());
+    }
+    return node;
+  }
+
+  FilterNodePtr parseFactor() {
+    std::string word = peekLower();
+
+    if (word == "not" || word == "!") {
+      pos_++;
+      return makeNot(parseFactor());
+    }
+
+    if (word == "(") {
+      pos_++;
+      FilterNodePtr node = parseOr();
+      if (next("')'") != ")") {
+        throw std::runtime_error("Missing ')' in capture filter");
+      }
+      return node;
+    }
+
+    return parsePrimitive();
+  }
+
+  static bool isQualifier(const std::string& word) {
+    return word == "src" || word == "dst" || word == "host" || word == "net" || word == "port";
+  }
+
+  FilterNodePtr parsePrimitive() {
+    std::string word = toLower(next("a primitive"));
+    std::optional<size_t> protocol;
+
+    auto keyword_it = keywords_.find(word);
+    if (keyword_it != keywords_.end()) {
+      protocol = keyword_it->second;
+      if (!isQualifier(peekLower())) {
+        return protocolTest(*protocol);
+      }
+      word = toLower(next("a qualifier"));
+    }
+
+    Direction direction = Direction::Any;
+    if (word == "src" || word == "dst") {
+      direction = word == "src" ? Direction::Source : Direction::Destination;
+      word = toLower(next("host, net or port"));
+    }
+
+    // The entry file is the link layer: "ether [src|dst] [host] <mac>"
+    if (protocol && *protocol == 0) {
+      std::string value = word == "host" ? next("a MAC address") : word;
+      return fieldTest(protocol, direction, "mac", parseMac(value), 48, value);
+    }
+
+    if (word == "host" || word == "net") {
+      std::string value = next("an address");
+      std::string address = value;
+      std::optional<uint32_t> prefix;
+
+      size_t slash = value.find('/');
+      if (slash != std::string::npos) {
+        if (word == "host") {
+          throw std::runtime_error("Use 'net' for a prefix: '" + value + "'");
+        }
+        address = value.substr(0, slash);
+        prefix = parseNumber(value.substr(slash + 1), 128);
+      }
+
+      std::vector<uint8_t> bytes(16);
+      std::string type;
+      if (inet_pton(AF_INET, address.c_str(), bytes.data()) == 1) {
+        bytes.resize(4);
+        type = "ipv4";
+      } else if (inet_pton(AF_INET6, address.c_str(), bytes.data()) == 1) {
+        type = "ipv6";
+      } else {
+        throw std::runtime_error("Invalid IP address '" + address + "' in capture filter");
+      }
+
+      uint32_t bits = static_cast<uint32_t>(bytes.size() * 8);
+      if (prefix && *prefix > bits) {
+        throw std::runtime_error("Prefix length out of range in '" + value + "'");
+      }
+
+      return fieldTest(protocol, direction, type, bytes, prefix.value_or(bits), value);
+    }
+
+    if (word == "port") {
+      std::string value = next("a port number");
+      uint32_t port = parseNumber(value, 65535);
+      std::vector<uint8_t> bytes = {static_cast<uint8_t>(port >> 8), static_cast<uint8_t>(port & 0xff)};
+      return fieldTest(protocol, direction, "port", bytes, 16, value);
+    }
+
+    throw std::runtime_error("Unknown capture filter primitive '" + word + "'");
+  }
+
+  static uint32_t parseNumber(const std::string& value, uint32_t max) {
+    if (value.empty() || !std::all_of(value.begin(), value.end(), [](unsigned char c) { return std::isdigit(c); })) {
+      throw std::runtime_error("Expected a number, got '" + value + "'");
+    }
+    unsigned long number = std::stoul(value);
+    if (number > max) {
+      throw std::runtime_error("Number out of range: '" + value + "'");
+    }
+    return static_cast<uint32_t>(number);
+  }
+
+  static std::vector<uint8_t> parseMac(const std::string& value) {
+    std::vector<uint8_t> bytes(6);
+    unsigned int parts[6];
+    char separator[5];
+    int consumed = 0;
+
+    if (std::sscanf(value.c_str(), "%2x%c%2x%c%2x%c%2x%c%2x%c%2x%n", &parts[0], &separator[0], &parts[1],
+                    &separator[1], &parts[2], &separator[2], &parts[3], &separator[3], &parts[4], &separator[4],
+                    &parts[5], &consumed) != 11 ||
+        static_cast<size_t>(consumed) != value.size()) {
+      throw std::runtime_error("Invalid MAC address '" + value + "' in capture filter");
+    }
+
+    for (int i = 0; i < 6; i++) {
+      bytes[i] = static_cast<uint8_t>(parts[i]);
+    }
+    return bytes;
+  }
+
+  FilterNodePtr protocolTest(size_t protocol) {
+    FilterNodePtr node;
+    for (const FilterProtocolPath& path : protocols_[protocol].paths) {
+      // "dns" reads UDP ports, which a non-first IPv4 fragment does not carry; "udp" itself only reads IPv4
+      std::vector<FilterFieldTest> tests = path.selectors;
+      tests.insert(tests.end(), path.guards.begin(), path.guards.begin() + path.selector_guards);
+      node = makeBinary(FilterNode::Kind::Or, std::move(node), makeTests(std::move(tests)));
+    }
+    if (!node) {
+      throw std::runtime_error("Protocol '" + protocols_[protocol].config.name + "' is not reachable from the entry file");
+    }
+    return node;
+  }
+
+  // OR over every (path to a protocol, matching field) pair; "port" selects 16-bit "... Port" fields
+  FilterNodePtr fieldTest(std::optional<size_t> only_protocol, Direction direction, const std::string& type,
+                          const std::vector<uint8_t>& value, uint32_t prefix_bits, const std::string& token) {
+    FilterNodePtr node;
+    uint32_t value_bits = static_cast<uint32_t>(value.size() * 8);
+
+    for (size_t p = 0; p < protocols_.size(); p++) {
+      if (only_protocol && *only_protocol != p) {
+        continue;
+      }
+
+      for (const auto& [offset_length, field] : sortedFields(protocols_[p].config)) {
+        bool type_matches = type == "port" ? field.description.find("Port") != std::string::npos : field.type == type;
+        if (!type_matches || offset_length[1] != value_bits || offset_length[0] % 8 != 0 ||
+            !directionMatches(direction, fieldDirection(field.description))) {
+          continue;
+        }
+
+        for (const FilterProtocolPath& path : protocols_[p].paths) {
+          if (!path.location.known) {
+            continue;
+          }
+
+          std::vector<FilterFieldTest> tests = path.selectors;
+          tests.insert(tests.end(), path.guards.begin(), path.guards.end());
+          std::vector<FilterFieldTest> field_tests = valueTests(path.location, offset_length[0], value, prefix_bits);
+          tests.insert(tests.end(), field_tests.begin(), field_tests.end());
+
+          node = makeBinary(FilterNode::Kind::Or, std::move(node), makeTests(std::move(tests)));
+        }
+      }
+    }
+
+    if (!node) {
+      throw std::runtime_error("No protocol file defines a field matching '" + token + "'");
+    }
+    return node;
+  }
+};
+
+class BpfEmitter {
+public:
+  int newLabel() {
+    label_positions_.push_back(-1);
+    return static_cast<int>(label_positions_.size() - 1);
+  }
+
+  void place(int label) { label_positions_[label] = static_cast<int>(code_.size()); }
+
+  // Every test must hold to reach true_label, the first failing one jumps to false_label
+  void emitTests(const std::vector<FilterFieldTest>& tests, int true_label, int false_label) {
+    if (tests.empty()) {
+      emitJump(true_label);
+      return;
+    }
+
+    for (size_t i = 0; i < tests.size(); i++) {
+      const FilterFieldTest& test = tests[i];
+      emitLoad(test);
+
+      uint32_t field_mask = test.bit_length == 32 ? 0xffffffff : ((1u << test.bit_length) - 1);
+      if ((test.mask & field_mask) != field_mask) {
+        emit(BPF_ALU | BPF_AND | BPF_K, test.mask);
+      }
+
+      int jt = i + 1 == tests.size() ? true_label : FALLTHROUGH;
+      emit(BPF_JMP | BPF_JEQ | BPF_K, test.value, jt, false_label);
+    }
+  }
+
+  void emitJump(int label) { emit(BPF_JMP | BPF_JA, 0, label, FALLTHROUGH); }
+
+  void emitReturn(uint32_t accept_length) { emit(BPF_RET | BPF_K, accept_length); }
+
+  std::vector<struct sock_filter> finish() {
+    relaxFarJumps();
+
+    std::vector<struct sock_filter> program;
+    program.reserve(code_.size());
+
+    for (size_t i = 0; i < code_.size(); i++) {
+      struct sock_filter insn = code_[i].insn;
+      if (BPF_CLASS(insn.code) == BPF_JMP) {
+        if (BPF_OP(insn.code) == BPF_JA) {
+          insn.k = static_cast<uint32_t>(distance(i, code_[i].jt_label));
+        } else {
+          insn.jt = static_cast<uint8_t>(distance(i, code_[i].jt_label));
+          insn.jf = static_cast<uint8_t>(distance(i, code_[i].jf_label));
+        }
+      }
+      program.push_back(insn);
+    }
+
+    return program;
+  }
+
+private:
+  static constexpr int FALLTHROUGH = -1;
+
+  struct PendingInsn {
+    struct sock_filter insn;
+    int jt_label;
+    int jf_label;
+  };
+
+  std::vector<PendingInsn> code_;
+  std::vector<int> label_positions_;
+
+  void emit(uint16_t code, uint32_t k, int jt_label = FALLTHROUGH, int jf_label = FALLTHROUGH) {
+    PendingInsn pending;
+    pending.insn = BPF_STMT(code, k);
+    pending.jt_label = jt_label;
+    pending.jf_label = jf_label;
+    code_.push_back(pending);
+  }
+
+  void emitLoad(const FilterFieldTest& test) {
+    uint32_t first_byte = test.bit_offset / 8;
+    uint32_t span = test.bit_offset % 8 + test.bit_length;
+
+    uint16_t size = BPF_W;
+    uint32_t size_bits = 32;
+    if (span <= 8) {
+      size = BPF_B;
+      size_bits = 8;
+    } else if (span <= 16) {
+      size = BPF_H;
+      size_bits = 16;
+    } else if (span > 32) {
+      throw std::runtime_error("Field spans more than 32 bits and cannot be loaded by BPF");
+    }
+
+    uint32_t k = test.location.offset + first_byte;
+    if (test.location.indexed) {
+      emit(BPF_LDX | BPF_B | BPF_MSH, test.location.index_byte);
+      emit(BPF_LD | size | BPF_IND, k);
+    } else {
+      emit(BPF_LD | size | BPF_ABS, k);
+    }
+
+    if (size_bits > span) {
+      emit(BPF_ALU | BPF_RSH | BPF_K, size_bits - span);
+    }
+    if (test.bit_length < size_bits) {
+      emit(BPF_ALU | BPF_AND | BPF_K, (1u << test.bit_length) - 1);
+    }
+  }
+
+  long distance(size_t from, int label) const {
+    return label == FALLTHROUGH ? 0 : label_positions_[label] - static_cast<long>(from) - 1;
+  }
+
+  // Conditional jumps only reach 255 instructions ahead; route longer ones through "ja" trampolines
+  void relaxFarJumps() {
+    bool changed = true;
+    while (changed) {
+      changed = false;
+
+      for (size_t i = 0; i < code_.size(); i++) {
+        PendingInsn& insn = code_[i];
+        if (BPF_CLASS(insn.insn.code) != BPF_JMP || BPF_OP(insn.insn.code) == BPF_JA) {
+          continue;
+        }
+        if (distance(i, insn.jt_label) <= 255 && distance(i, insn.jf_label) <= 255) {
+          continue;
+        }
+
+        int original_next = newLabel();
+        label_positions_[original_next] = static_cast<int>(i + 1);
+        int jt_target = insn.jt_label == FALLTHROUGH ? original_next : insn.jt_label;
+        int jf_target = insn.jf_label == FALLTHROUGH ? original_next : insn.jf_label;
+
+        for (int& position : label_positions_) {
+          if (position > static_cast<int>(i)) {
+            position += 2;
+          }
+        }
+
+        int second_trampoline = newLabel();
+        label_positions_[second_trampoline] = static_cast<int>(i + 2);
+        code_[i].jt_label = FALLTHROUGH;
+        code_[i].jf_label = second_trampoline;
+
+        PendingInsn jump_true{BPF_STMT(BPF_JMP | BPF_JA, 0), jt_target, FALLTHROUGH};
+        PendingInsn jump_false{BPF_STMT(BPF_JMP | BPF_JA, 0), jf_target, FALLTHROUGH};
+        code_.insert(code_.begin() + i + 1, {jump_true, jump_false});
+
+        changed = true;
+        break;
+      }
+    }
+  }
+};
+
+void generate(BpfEmitter& emitter, const FilterNode& node, int true_label, int false_label) {
+  switch (node.kind) {
+    case FilterNode::Kind::Tests: emitter.emitTests(node.tests, true_label, false_label); break;
+    case FilterNode::Kind::Not: generate(emitter, *node.left, false_label, true_label); break;
+    case FilterNode::Kind::And: {
+      int right = emitter.newLabel();
+      generate(emitter, *node.left, right, false_label);
+      emitter.place(right);
+      generate(emitter, *node.right, true_label, false_label);
+      break;
+    }
+    case FilterNode::Kind::Or: {
+      int right = emitter.newLabel();
+      generate(emitter, *node.left, true_label, right);
+      emitter.place(right);
+      generate(emitter, *node.right, true_label, false_label);
+      break;
+    }
+  }
+}
+
+} // namespace
+
+FilterCompiler::FilterCompiler(const std::string& protocol_entry_file) {
+  buildProtocolTable(protocol_entry_file);
+}
+
+std::vector<struct sock_filter> FilterCompiler::compile(const std::string& expression, uint32_t accept_length) const {
+  if (std::all_of(expression.begin(), expression.end(), [](unsigned char c) { return std::isspace(c); })) {
+    return {};
+  }
+
+  FilterParser parser(protocols_, keywords_, expression);
+  FilterNodePtr root = parser.parse();
+
+  BpfEmitter emitter;
+  int accept = emitter.newLabel();
+  int reject = emitter.newLabel();
+
+  generate(emitter, *root, accept, reject);
+  emitter.place(accept);
+  emitter.emitReturn(accept_length);
+  emitter.place(reject);
+  emitter.emitReturn(0);
+
+  std::vector<struct sock_filter> program = emitter.finish();
+  if (program.size() > BPF_MAXINSNS) {
+    throw std::runtime_error("Capture filter compiles to more than " + std::to_string(BPF_MAXINSNS) + " instructions");
+  }
+  return program;
+}
+
+void FilterCompiler::buildProtocolTable(const std::string& protocol_entry_file) {
+  std::unordered_map<std::string, size_t> index_by_file;
+  std::unordered_map<std::string, size_t> depth_by_file;
+
+  FilterProtocol entry;
+  entry.file = protocol_entry_file;
+  entry.config = protocol_loader_.loadProtocol(protocol_entry_file);
+  entry.paths.push_back(FilterProtocolPath());
+  protocols_.push_back(std::move(entry));
+  index_by_file[protocol_entry_file] = 0;
+  depth_by_file[protocol_entry_file] = 0;
+  registerKeywords(0);
+
+  // Breadth-first so each protocol only keeps its shortest paths (ipv4.json via ethernet, not via vlan)
+  std::vector<size_t> frontier = {0};
+  for (size_t depth = 1; depth <= FILTER_MAX_PATH_DEPTH && !frontier.empty(); depth++) {
+    std::vector<size_t> next_frontier;
+
+    for (size_t parent_index : frontier) {
+      const ProtocolConfig parent_config = protocols_[parent_index].config;
+      const std::vector<FilterProtocolPath> parent_paths = protocols_[parent_index].paths;
+      const std::string parent_file = protocols_[parent_index].file;
+
+      if (!parent_config.next_protocol.has_value()) {
+        continue;
+      }
+
+      const NextProtocol& next = parent_config.next_protocol.value();
+      uint32_t selector_offset = 0;
+      uint32_t selector_length = 0;
+      if (!parseOffsetLength(next.selector, selector_offset, selector_length) || selector_length > 32) {
+        continue;
+      }
+
+      std::optional<std::array<uint32_t, 2>> fragment_field;
+      for (const auto& [offset_length, field] : parent_config.header) {
+        if (field.description.find("Fragment Offset") != std::string::npos && offset_length[1] <= 32) {
+          fragment_field = offset_length;
+        }
+      }
+
+      std::vector<std::pair<uint16_t, std::string>> mappings(next.mappings.begin(), next.mappings.end());
+      std::sort(mappings.begin(), mappings.end());
+
+      for (const auto& [value, relative_file] : mappings) {
+        std::string child_file = resolveProtocolPath(parent_file, relative_file);
+
+        auto depth_it = depth_by_file.find(child_file);
+        if (depth_it != depth_by_file.end() && depth_it->second < depth) {
+          continue;
+        }
+
+        size_t child_index = 0;
+        auto index_it = index_by_file.find(child_file);
+        if (index_it == index_by_file.end()) {
+          FilterProtocol child;
+          child.file = child_file;
+          try {
+            child.config = protocol_loader_.loadProtocol(child_file);
+          } catch (const std::exception& e) {
+            std::cerr << "Capture filter skips " << child_file << ": " << e.what() << std::endl;
+            continue;
+          }
+
+          child_index = protocols_.size();
+          protocols_.push_back(std::move(child));
+          index_by_file[child_file] = child_index;
+          depth_by_file[child_file] = depth;
+          registerKeywords(child_index);
+          next_frontier.push_back(child_index);
+        } else {
+          child_index = index_it->second;
+        }
+
+        for (const FilterProtocolPath& parent_path : parent_paths) {
+          if (!parent_path.location.known) {
+            continue;
+          }
+
+          FilterProtocolPath path = parent_path;
+          path.selector_guards = parent_path.guards.size();
+
+          FilterFieldTest selector;
+          selector.location = parent_path.location;
+          selector.bit_offset = selector_offset;
+          selector.bit_length = selector_length;
+          selector.value = value;
+          path.selectors.push_back(selector);
+
+          if (fragment_field) {
+            FilterFieldTest unfragmented;
+            unfragmented.location = parent_path.location;
+            unfragmented.bit_offset = (*fragment_field)[0];
+            unfragmented.bit_length = (*fragment_field)[1];
+            unfragmented.value = 0;
+            path.guards.push_back(unfragmented);
+          }
+
+          path.location = childLocation(parent_path.location, next.start_after);
+          protocols_[child_index].paths.push_back(std::move(path));
+        }
+      }
+    }
+
+    frontier = std::move(next_frontier);
+  }
+}
+
+void FilterCompiler::registerKeywords(size_t protocol_index) {
+  std::string keyword = toLower(protocols_[protocol_index].config.name);
+  std::replace(keyword.begin(), keyword.end(), ' ', '_');
+  keywords_.emplace(keyword, protocol_index);
+
+  static const std::unordered_map<std::string, std::string> aliases = {
+      {"ethernet", "ether"}, {"ipv4", "ip"}, {"ipv6", "ip6"}, {"icmpv6", "icmp6"}};
+
+  auto alias_it = aliases.find(keyword);
+  if (alias_it != aliases.end()) {
+    keywords_.emplace(alias_it->second, protocol_index);
+  }
+}
+
+FilterLocation FilterCompiler::childLocation(const FilterLocation& parent, const std::string& start_after) const {
+  FilterLocation child = parent;
+  if (!parent.known) {
+    return child;
+  }
+
+  std::string expression;
+  for (char c : start_after) {
+    if (!std::isspace(static_cast<unsigned char>(c))) {
+      expression += c;
+    }
+  }
+
+  if (!expression.empty() && std::all_of(expression.begin(), expression.end(), ::isdigit)) {
+    uint32_t bits = static_cast<uint32_t>(std::stoul(expression));
+    child.known = bits % 8 == 0;
+    child.offset += bits / 8;
+    return child;
+  }
+
+  // "[o_4] * 4 * 8" on a low nibble is exactly what BPF's "ldx 4*([k]&0xf)" computes
+  uint32_t field_offset = 0;
+  uint32_t field_length = 0;
+  int consumed = 0;
+  if (!parent.indexed && expression.rfind("calculate:", 0) == 0 &&
+      std::sscanf(expression.c_str() + 10, "[%u_%u]*4*8%n", &field_offset, &field_length, &consumed) == 2 &&
+      static_cast<size_t>(consumed) == expression.size() - 10 && field_length == 4 && field_offset % 8 == 4) {
+    child.indexed = true;
+    child.index_byte = parent.offset + field_offset / 8;
+    return child;
+  }
+
+  child.known = false;
+  return child;
+}
+
+std::string FilterCompiler::resolveProtocolPath(const std::string& current_path,
+                                                const std::string& relative_path) const {
+  fs::path current(current_path);
+  fs::path resolved = current.parent_path() / relative_path;
+  return resolved.lexically_normal().string();
+}
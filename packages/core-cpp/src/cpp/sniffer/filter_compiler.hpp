@@ -0,0 +1,74 @@
+#pragma once
+
+#include "../protocol_loader/protocol_loader.hpp"
+#include "../utils/common/common.hpp"
+#include <cstdint>
+#include <linux/filter.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Where a protocol layer starts in the frame: a constant byte offset, plus an IPv4-style
+// header length (4 * low nibble of index_byte) when the layer follows a variable-size header
+struct FilterLocation {
+  uint32_t offset = 0;
+  bool indexed = false;
+  uint32_t index_byte = 0;
+  bool known = true;
+};
+
+// "field of the layer at location, masked, equals value", field at most 32 bits wide
+struct FilterFieldTest {
+  FilterLocation location;
+  uint32_t bit_offset = 0;
+  uint32_t bit_length = 0;
+  uint32_t mask = 0xffffffff;
+  uint32_t value = 0;
+};
+
+// One way of reaching a protocol from the entry file
+struct FilterProtocolPath {
+  std::vector<FilterFieldTest> selectors; // Every parent selector equals its mapping value
+  std::vector<FilterFieldTest> guards;    // Parents whose fragment offset must be 0 before reading this layer
+  size_t selector_guards = 0;             // Leading guards that cover the layers the selectors read
+  FilterLocation location;
+};
+
+struct FilterProtocol {
+  std::string file;
+  ProtocolConfig config;
+  std::vector<FilterProtocolPath> paths;
+};
+
+// Compiles a tcpdump-like capture filter into a classic BPF program for SO_ATTACH_FILTER.
+//
+//   expr      := term ( ("or" | "||") term )*
+//   term      := factor ( ("and" | "&&") factor )*
+//   factor    := ("not" | "!") factor | "(" expr ")" | primitive
+//   primitive := <proto>
+//              | ether [src|dst] [host] <mac>
+//              | [<proto>] [src|dst] host <ipv4|ipv6>
+//              | [<proto>] [src|dst] net <ipv4|ipv6>[/prefix]
+//              | [<proto>] [src|dst] port <number>
+//
+// Protocol keywords, selector values, layer offsets and address/port fields all come from the
+// protocol JSON graph (lowercased "name", plus ip/ip6/icmp6 aliases), following the shortest
+// paths from the entry file. Encapsulated traffic (VLAN, MPLS) only matches its own keyword.
+// Throws std::runtime_error on syntax errors or predicates the protocol files cannot express.
+class FilterCompiler {
+public:
+  explicit FilterCompiler(const std::string& protocol_entry_file);
+
+  std::vector<struct sock_filter> compile(const std::string& expression,
+                                          uint32_t accept_length = FILTER_ACCEPT_LENGTH) const;
+
+private:
+  ProtocolLoader protocol_loader_;
+  std::vector<FilterProtocol> protocols_;
+  std::unordered_map<std::string, size_t> keywords_;
+
+  void buildProtocolTable(const std::string& protocol_entry_file);
+  void registerKeywords(size_t protocol_index);
+  FilterLocation childLocation(const FilterLocation& parent, const std::string& start_after) const;
+  std::string resolveProtocolPath(const std::string& current_path, const std::string& relative_path) const;
+};
@@ -1,28 +1,101 @@
 #include "./network_sniffer.hpp"
+#include <algorithm>
 #include <cstring>
+#include <iostream>
 
-NetworkSniffer::NetworkSniffer()
-    : packet_capture_(nullptr), ring_buffer_(std::make_unique<RingBuffer>()), parser_(nullptr), is_running_(false),
-      should_stop_(false) {}
+NetworkSniffer::NetworkSniffer() : merger_(nullptr), parser_(nullptr), is_running_(false), should_stop_(false) {}
 
 NetworkSniffer::~NetworkSniffer() {
   stopSniffing();
 }
 
-bool NetworkSniffer::startSniffing(const std::string& interface_name, std::unique_ptr<PacketCallback> callback) {
+bool NetworkSniffer::startSniffing(const std::string& interface_name, std::unique_ptr<PacketCallback> callback,
+                                   const SnifferOptions& options) {
+  return startSniffing(std::vector<std::string>{interface_name}, std::move(callback), options);
+}
+
+bool NetworkSniffer::startSniffing(const std::vector<std::string>& interface_names,
+                                   std::unique_ptr<PacketCallback> callback, const SnifferOptions& options) {
   if (is_running_.load()) {
     return false;
   }
 
-  if (!parser_) {
+  if (!getParser()) {
+    return false;
+  }
+
+  if (interface_names.empty()) {
+    last_error_ = "At least one interface is required";
+    return false;
+  }
+
+  for (size_t i = 0; i < interface_names.size(); i++) {
+    if (std::find(interface_names.begin(), interface_names.begin() + i, interface_names[i]) !=
+        interface_names.begin() + i) {
+      last_error_ = "Interface " + interface_names[i] + " is listed twice";
+      return false;
+    }
+  }
+
+  if (interface_names.size() * options.fanout_workers > MAX_CAPTURE_WORKERS) {
+    last_error_ = "At most " + std::to_string(MAX_CAPTURE_WORKERS) + " capture workers (interfaces x fan-out)";
+    return false;
+  }
+
+  if (options.fanout_workers == 0 || options.fanout_workers > MAX_FANOUT_WORKERS) {
+    last_error_ = "Fan-out worker count must be between 1 and " + std::to_string(MAX_FANOUT_WORKERS);
+    return false;
+  }
+
+  if (options.parser_threads == 0 || options.parser_threads > MAX_PARSER_THREADS) {
+    last_error_ = "Parser thread count must be between 1 and " + std::to_string(MAX_PARSER_THREADS);
+    return false;
+  }
+
+  if (options.capture.mode == CaptureMode::Xdp && options.fanout_workers > 1) {
+    last_error_ = "XDP capture binds a single RX queue per interface, fan-out workers are not supported";
+    return false;
+  }
+
+  if (options.capture.snaplen == 0 || options.capture.snaplen > MAX_PACKET_SIZE) {
+    last_error_ = "Snap length must be between 1 and " + std::to_string(MAX_PACKET_SIZE);
+    return false;
+  }
+
+  for (const ThreadSchedule* schedule : {&options.capture_thread, &options.processing_thread}) {
+    std::string error = validateThreadSchedule(*schedule);
+    if (!error.empty()) {
+      last_error_ = error;
+      return false;
+    }
+  }
+
+  if (options.buffer_bytes < RING_BUFFER_MIN_BYTES || options.buffer_bytes > RING_BUFFER_MAX_BYTES) {
+    last_error_ = "Buffer size must be between " + std::to_string(RING_BUFFER_MIN_BYTES) + " and " +
+                  std::to_string(RING_BUFFER_MAX_BYTES) + " bytes";
+    return false;
+  }
+
+  if (options.block_timeout.count() < 0) {
+    last_error_ = "Block timeout cannot be negative";
+    return false;
+  }
+
+  SnifferOptions effective_options = options;
+  if (!compileFilter(options.filter, effective_options.capture)) {
     return false;
   }
 
-  packet_capture_ = std::make_unique<PacketCapture>(interface_name);
+  {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    finished_stats_ = CaptureStats();
+    session_generation_ = parser_generation_.load(std::memory_order_acquire);
+  }
+  merger_delivered_.reset();
 
-  if (!packet_capture_->initialize()) {
-    last_error_ = packet_capture_->getLastError();
-    packet_capture_.reset();
+  if (!createWorkers(interface_names, effective_options)) {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    workers_.clear();
     return false;
   }
 
@@ -31,70 +104,262 @@ bool NetworkSniffer::startSniffing(const std::string& interface_name, std::uniqu
     packet_callback_ = std::move(callback);
   }
 
+  // Workers each see one interface or a hash-selected share of it, the merger restores capture order.
+  // A ring only surfaces a block once it is full or retired, so its timeout widens the window.
+  if (workers_.size() > 1) {
+    std::chrono::microseconds window(MERGE_REORDER_WINDOW_US);
+    if (std::any_of(workers_.begin(), workers_.end(), [](const std::unique_ptr<CaptureWorker>& worker) {
+          return worker->capture->getCaptureMode() == CaptureMode::RxRing;
+        })) {
+      window += std::chrono::milliseconds(RX_RING_BLOCK_TIMEOUT_MS);
+    }
+
+    merger_ = std::make_unique<PacketMerger>(
+        workers_.size(),
+        [this](const PacketView& packet, const ParsedPacket& parsed) {
+          deliverBatch(&packet, &parsed, 1, merger_delivered_);
+        },
+        window);
+    merger_->start();
+  }
+
+  capture_schedule_ = options.capture_thread;
+  processing_schedule_ = options.processing_thread;
+  parse_mode_ = options.parse_mode;
+
   should_stop_.store(false);
   is_running_.store(true);
 
-  processing_thread_ = std::thread(&NetworkSniffer::processingWorker, this);
-  capture_thread_ = std::thread(&NetworkSniffer::captureWorker, this);
+  for (auto& worker : workers_) {
+    worker->processing_thread = std::thread(&NetworkSniffer::processingWorker, this, std::ref(*worker));
+    worker->capture_thread = std::thread(&NetworkSniffer::captureWorker, this, std::ref(*worker));
+  }
+
+  return true;
+}
+
+bool NetworkSniffer::compileFilter(const std::string& expression, CaptureOptions& capture_options) {
+  if (expression.empty()) {
+    return true;
+  }
+
+  try {
+    FilterCompiler compiler(getParser()->getProtocolEntryFile());
+    capture_options.filter = compiler.compile(expression);
+  } catch (const std::exception& e) {
+    last_error_ = "Invalid capture filter: " + std::string(e.what());
+    return false;
+  }
+
+  return true;
+}
+
+bool NetworkSniffer::createWorkers(const std::vector<std::string>& interface_names, const SnifferOptions& options) {
+  for (const std::string& interface_name : interface_names) {
+    // Fan-out groups are per device, each interface gets its own kernel-assigned id
+    int fanout_group = -1;
+
+    for (size_t i = 0; i < options.fanout_workers; i++) {
+      if (!createWorker(interface_name, options, fanout_group)) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+bool NetworkSniffer::createWorker(const std::string& interface_name, const SnifferOptions& options,
+                                  int& fanout_group) {
+  auto worker = std::make_unique<CaptureWorker>();
+  worker->index = workers_.size();
+  worker->capture = std::make_unique<PacketCapture>(interface_name, options.capture);
+  worker->ring = std::make_unique<RingBuffer>(options.buffer_bytes, options.overflow_policy, options.block_timeout,
+                                              options.wait_strategy);
+
+  if (!worker->capture->initialize()) {
+    last_error_ = worker->capture->getLastError();
+    return false;
+  }
+  worker->interface_index = worker->capture->getBoundInterfaceIndex();
+
+  if (options.fanout_workers > 1) {
+    if (!worker->capture->joinFanoutGroup(fanout_group)) {
+      last_error_ = worker->capture->getLastError();
+      return false;
+    }
+    fanout_group = worker->capture->getFanoutGroup();
+  }
+
+  // Worker 0 shares the published parser until the first swap, the others parse with clones
+  worker->parser_generation = parser_generation_.load(std::memory_order_acquire);
+  worker->parser = getParser();
+  if (worker->index != 0) {
+    worker->parser = worker->parser->clone();
+  }
 
+  if (options.parser_threads > 1) {
+    for (size_t i = 0; i < options.parser_threads; i++) {
+      worker->parser_slots.push_back(std::make_unique<CaptureWorker::ThreadSlot>());
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(stats_mutex_);
+  workers_.push_back(std::move(worker));
   return true;
 }
 
-void NetworkSniffer::captureWorker() {
-  auto handler = [this](const uint8_t* data, size_t length) { this->handleRawPacket(data, length); };
+void NetworkSniffer::placeThread(CaptureWorker& worker, CaptureWorker::ThreadSlot& slot, const char* role,
+                                 const ThreadSchedule& schedule) {
+  slot.placement.role = role;
+  slot.placement.worker = worker.index;
+  slot.placement.interface_index = worker.interface_index;
+
+  // A refused setting (SCHED_FIFO without CAP_SYS_NICE, a CPU taken offline) leaves the thread running as is
+  if (!schedule.isDefault()) {
+    slot.placement.error = applyThreadSchedule(schedule);
+    if (!slot.placement.error.empty()) {
+      std::cerr << "Warning: " << role << " thread " << worker.index << ": " << slot.placement.error << std::endl;
+    }
+  }
+
+  pid_t tid = currentThreadId();
+  readThreadPlacement(tid, slot.placement);
+  slot.tid.store(tid, std::memory_order_release);
+}
+
+void NetworkSniffer::captureWorker(CaptureWorker& worker) {
+  placeThread(worker, worker.capture_slot, "capture", capture_schedule_);
 
-  packet_capture_->startCapture(handler);
+  auto handler = [this, &worker](const PacketView* packets, size_t count) {
+    this->handleCapturedBatch(worker, packets, count);
+  };
+
+  // recv() mode receives straight into the worker's ring
+  auto provider = [&worker](size_t capacity) { return worker.ring->reserve(capacity); };
+
+  worker.capture->startCapture(handler, provider);
 }
 
-void NetworkSniffer::handleRawPacket(const uint8_t* data, size_t length) {
+void NetworkSniffer::handleCapturedBatch(CaptureWorker& worker, const PacketView* packets, size_t count) {
   if (should_stop_.load()) {
     return;
   }
 
-  RawPacket packet;
-  packet.length = length;
-  packet.valid = true;
+  // Only the captured bytes are copied, straight from the socket or ring frames into the byte ring
+  worker.ring->pushBatch(packets, count);
 
-  if (length <= MAX_PACKET_SIZE) {
-    std::memcpy(packet.data.data(), data, length);
-    ring_buffer_->push(packet);
+  uint64_t oversize = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (packets[i].original_length > MAX_PACKET_SIZE) {
+      oversize++;
+    }
+  }
+  worker.capture_counters.captured.increment(count);
+  if (oversize > 0) {
+    worker.capture_counters.oversize.increment(oversize);
   }
 }
 
-void NetworkSniffer::processingWorker() {
+void NetworkSniffer::processingWorker(CaptureWorker& worker) {
+  placeThread(worker, worker.processing_slot, "processing", processing_schedule_);
+  if (!worker.parser_slots.empty()) {
+    pooledProcessingWorker(worker);
+    return;
+  }
+
+  // Packets are parsed and delivered in place in the ring, their space is released once the batch is done
+  PacketView packets[PROCESSING_BATCH_SIZE];
+  std::vector<ParsedPacket> parsed_packets(PROCESSING_BATCH_SIZE);
+
   while (!should_stop_.load()) {
-    RawPacket raw_packet;
+    size_t count = worker.ring->peekBatch(packets, PROCESSING_BATCH_SIZE);
+    if (count > 0) {
+      processBatch(worker, packets, parsed_packets.data(), count);
+      worker.ring->releaseBatch();
+    } else {
+      worker.ring->waitForData();
+    }
+  }
 
-    if (ring_buffer_->pop(raw_packet)) {
-      ParsedPacket parsed = parser_->parsePacket(raw_packet);
+  while (size_t count = worker.ring->peekBatch(packets, PROCESSING_BATCH_SIZE)) {
+    processBatch(worker, packets, parsed_packets.data(), count);
+    worker.ring->releaseBatch();
+  }
+}
 
-      PacketCallback* callback_ptr = nullptr;
-      {
-        std::lock_guard<std::mutex> lock(callback_mutex_);
-        callback_ptr = packet_callback_.get();
-      }
+// Packets leave the ring as pooled copies, so its space is released as soon as a batch is queued. Parser
+// threads take batches in sequence order and this thread delivers them in that order as they complete.
+void NetworkSniffer::pooledProcessingWorker(CaptureWorker& worker) {
+  ParserPool pool(*worker.parser, worker.parser_slots.size(), parse_mode_, [this, &worker](size_t index) {
+    placeThread(worker, *worker.parser_slots[index], "parser", processing_schedule_);
+  });
+  ParsedBatchSink sink = [this, &worker](const PacketView* packets, ParsedPacket* parsed_packets, size_t count) {
+    forwardBatch(worker, packets, parsed_packets, count);
+  };
+
+  PacketView packets[PROCESSING_BATCH_SIZE];
+  bool draining = false;
+  while (true) {
+    if (pool.isFull()) {
+      pool.deliver(sink, true);
+      continue;
+    }
 
-      if (callback_ptr != nullptr) {
-        (*callback_ptr)(raw_packet, parsed);
+    size_t count = worker.ring->peekBatch(packets, PROCESSING_BATCH_SIZE);
+    if (count > 0) {
+      if (refreshParser(worker)) {
+        pool.setParser(*worker.parser);
       }
+      pool.submit(packets, count);
+      worker.ring->releaseBatch();
+      pool.deliver(sink, false);
+    } else if (!pool.isIdle()) {
+      pool.deliver(sink, true);
+    } else if (draining) {
+      break;
+    } else if (should_stop_.load()) {
+      // Capture has stopped, one more pass empties the ring
+      draining = true;
     } else {
-      ring_buffer_->waitForData(std::chrono::milliseconds(100));
+      worker.ring->waitForData();
     }
   }
+}
 
-  RawPacket raw_packet;
-  while (ring_buffer_->pop(raw_packet)) {
-    ParsedPacket parsed = parser_->parsePacket(raw_packet);
+void NetworkSniffer::processBatch(CaptureWorker& worker, const PacketView* packets, ParsedPacket* parsed_packets,
+                                  size_t count) {
+  refreshParser(worker);
+  worker.parser->parseBatch(packets, parsed_packets, count, parse_mode_);
+  forwardBatch(worker, packets, parsed_packets, count);
+}
+
+void NetworkSniffer::forwardBatch(CaptureWorker& worker, const PacketView* packets, ParsedPacket* parsed_packets,
+                                  size_t count) {
+  worker.processing_counters.parsed.increment(count);
 
-    PacketCallback* callback_ptr = nullptr;
-    {
-      std::lock_guard<std::mutex> lock(callback_mutex_);
-      callback_ptr = packet_callback_.get();
+  if (merger_) {
+    for (size_t i = 0; i < count; i++) {
+      merger_->push(worker.index, packets[i], std::move(parsed_packets[i]));
     }
+  } else {
+    deliverBatch(packets, parsed_packets, count, worker.processing_counters.delivered);
+  }
+}
 
-    if (callback_ptr != nullptr) {
-      (*callback_ptr)(raw_packet, parsed);
+void NetworkSniffer::deliverBatch(const PacketView* packets, const ParsedPacket* parsed_packets, size_t count,
+                                  ThreadCounter& delivered) {
+  PacketCallback* callback_ptr = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(callback_mutex_);
+    callback_ptr = packet_callback_.get();
+  }
+
+  if (callback_ptr != nullptr) {
+    for (size_t i = 0; i < count; i++) {
+      (*callback_ptr)(packets[i], parsed_packets[i]);
     }
+    delivered.increment(count);
   }
 }
 
@@ -105,18 +370,33 @@ void NetworkSniffer::stopSniffing() {
 
   should_stop_.store(true);
 
-  if (packet_capture_) {
-    packet_capture_->stopCapture();
+  for (auto& worker : workers_) {
+    worker->capture->stopCapture();
+    worker->ring->notifyConsumer();
   }
 
-  ring_buffer_->notifyConsumer();
+  for (auto& worker : workers_) {
+    if (worker->capture_thread.joinable()) {
+      worker->capture_thread.join();
+    }
+  }
 
-  if (capture_thread_.joinable()) {
-    capture_thread_.join();
+  for (auto& worker : workers_) {
+    if (worker->processing_thread.joinable()) {
+      worker->processing_thread.join();
+    }
   }
 
-  if (processing_thread_.joinable()) {
-    processing_thread_.join();
+  // Processing threads have drained their rings, flush what the merger still holds
+  if (merger_) {
+    merger_->stop();
+    merger_.reset();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    finished_stats_ = collectStats(false);
+    workers_.clear();
   }
 
   {
@@ -124,7 +404,6 @@ void NetworkSniffer::stopSniffing() {
     packet_callback_ = nullptr;
   }
 
-  packet_capture_.reset();
   is_running_.store(false);
 }
 
@@ -133,16 +412,79 @@ bool NetworkSniffer::isRunning() const {
 }
 
 void NetworkSniffer::setParser(std::unique_ptr<ParserModel> parser) {
-  if (is_running_.load()) {
-    return;
-  }
-  parser_ = std::move(parser);
+  std::atomic_store(&parser_, std::shared_ptr<ParserModel>(std::move(parser)));
+  parser_generation_.fetch_add(1, std::memory_order_release);
 }
 
-ParserModel* NetworkSniffer::getParser() const {
-  return parser_.get();
+std::shared_ptr<ParserModel> NetworkSniffer::getParser() const {
+  return std::atomic_load(&parser_);
+}
+
+// The parser a worker drops is freed once no other thread holds it; lazily parsed packets still in flight hold
+// their own reference to its graph
+bool NetworkSniffer::refreshParser(CaptureWorker& worker) {
+  uint64_t generation = parser_generation_.load(std::memory_order_acquire);
+  if (generation == worker.parser_generation) {
+    return false;
+  }
+
+  // A swap racing with this one is seen as another generation change on the next batch
+  worker.parser = getParser()->clone();
+  worker.parser_generation = generation;
+  return true;
 }
 
 const std::string& NetworkSniffer::getLastError() const {
   return last_error_;
-}
\ No newline at end of file
+}
+
+CaptureStats NetworkSniffer::getStats() {
+  std::lock_guard<std::mutex> lock(stats_mutex_);
+  if (workers_.empty()) {
+    return finished_stats_;
+  }
+  return collectStats(true);
+}
+
+// Caller holds stats_mutex_
+CaptureStats NetworkSniffer::collectStats(bool threads_alive) {
+  CaptureStats stats;
+
+  for (auto& worker : workers_) {
+    CaptureStats worker_stats;
+    worker->capture->readKernelStats(worker_stats.kernel_received, worker_stats.kernel_dropped);
+    worker_stats.captured = worker->capture_counters.captured.read();
+    worker_stats.oversize = worker->capture_counters.oversize.read();
+    worker_stats.ring_dropped_newest = worker->ring->getDroppedNewestCount();
+    worker_stats.ring_dropped_oldest = worker->ring->getDroppedOldestCount();
+    worker_stats.ring_block_timeouts = worker->ring->getBlockTimeoutCount();
+    worker_stats.parsed = worker->processing_counters.parsed.read();
+    worker_stats.delivered = worker->processing_counters.delivered.read();
+
+    std::vector<CaptureWorker::ThreadSlot*> slots = {&worker->capture_slot, &worker->processing_slot};
+    for (const auto& slot : worker->parser_slots) {
+      slots.push_back(slot.get());
+    }
+    for (CaptureWorker::ThreadSlot* slot : slots) {
+      pid_t tid = slot->tid.load(std::memory_order_acquire);
+      if (tid == 0) {
+        continue;
+      }
+      ThreadPlacement placement = slot->placement;
+      if (threads_alive) {
+        readThreadPlacement(tid, placement);
+      }
+      worker_stats.threads.push_back(std::move(placement));
+    }
+    stats += worker_stats;
+  }
+  stats.delivered += merger_delivered_.read();
+  stats.protocol_reloads = parser_generation_.load(std::memory_order_acquire) - session_generation_;
+
+  std::lock_guard<std::mutex> lock(callback_mutex_);
+  if (packet_callback_) {
+    stats.callback_backlog = packet_callback_->getBacklog();
+  }
+
+  return stats;
+}
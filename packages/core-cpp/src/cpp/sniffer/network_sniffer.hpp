@@ -3,15 +3,48 @@
 #include "../parser/parser_model.hpp"
 #include "../utils/buffer/ring_buffer.hpp"
 #include "../utils/packets/packet_model.hpp"
+#include "../utils/stats/capture_stats.hpp"
+#include "./filter_compiler.hpp"
 #include "./packet_capture.hpp"
+#include "./packet_merger.hpp"
+#include "./parser_pool.hpp"
+#include "./thread_schedule.hpp"
 #include <atomic>
 #include <memory>
 #include <mutex>
 #include <thread>
+#include <vector>
 
 struct PacketCallback {
   virtual ~PacketCallback() = default;
-  virtual void operator()(const RawPacket& raw, const ParsedPacket& parsed) const = 0;
+  // The packet is only borrowed for the duration of the call, copy whatever has to outlive it
+  virtual void operator()(const PacketView& packet, const ParsedPacket& parsed) const = 0;
+
+  // Packets accepted but not yet consumed, for callbacks that hand off to another thread
+  virtual uint64_t getBacklog() const { return 0; }
+};
+
+struct SnifferOptions {
+  CaptureOptions capture;
+  // More than one opens that many sockets in a PACKET_FANOUT hash group, each with its own parser
+  size_t fanout_workers = 1;
+  // More than one parses each worker's packets on that many threads, see ParserPool; the worker's processing
+  // thread then only feeds them and delivers in capture order
+  size_t parser_threads = 1;
+  // tcpdump-like expression compiled against the parser's protocol files, see FilterCompiler
+  std::string filter;
+  // Bytes of the ring between each capture thread and its processing thread, see RingBuffer
+  size_t buffer_bytes = RING_BUFFER_BYTES;
+  // What a capture thread does when that ring is full
+  OverflowPolicy overflow_policy = OverflowPolicy::DropNewest;
+  std::chrono::milliseconds block_timeout{RING_BLOCK_TIMEOUT_MS};
+  // How each processing thread waits on its empty ring; spinning trades a busy core for wake-up latency
+  WaitStrategy wait_strategy = WaitStrategy::SpinPark;
+  // Lazy hands callbacks packets with only the layer chain decoded, see ParserModel::parseChain()
+  ParseMode parse_mode = ParseMode::Eager;
+  // Affinity and scheduling each capture / processing thread applies to itself when it starts
+  ThreadSchedule capture_thread;
+  ThreadSchedule processing_thread;
 };
 
 class NetworkSniffer {
@@ -19,29 +52,93 @@ public:
   NetworkSniffer();
   ~NetworkSniffer();
 
+  // Allowed while capturing: the parser is published RCU-style and each processing thread switches to a clone of
+  // it before its next batch, packets already parsed keep the graph they were parsed with
   void setParser(std::unique_ptr<ParserModel> parser);
-  ParserModel* getParser() const;
-  bool startSniffing(const std::string& interface_name, std::unique_ptr<PacketCallback> callback);
+  std::shared_ptr<ParserModel> getParser() const;
+  bool startSniffing(const std::string& interface_name, std::unique_ptr<PacketCallback> callback,
+                     const SnifferOptions& options = SnifferOptions());
+  // One capture pipeline per interface (times fanout_workers), merged into a single timestamp-ordered stream
+  bool startSniffing(const std::vector<std::string>& interface_names, std::unique_ptr<PacketCallback> callback,
+                     const SnifferOptions& options = SnifferOptions());
   void stopSniffing();
   bool isRunning() const;
   const std::string& getLastError() const;
 
+  // Current session's counters, or the last session's final counters once stopped
+  CaptureStats getStats();
+
 private:
-  std::unique_ptr<PacketCapture> packet_capture_;
-  std::unique_ptr<RingBuffer> ring_buffer_;
-  std::unique_ptr<ParserModel> parser_;
+  // One capture socket with its own ring, parser and thread pair
+  struct CaptureWorker {
+    size_t index = 0;
+    int interface_index = -1;
+    std::unique_ptr<PacketCapture> capture;
+    std::unique_ptr<RingBuffer> ring;
+    // Only touched by the processing thread once it runs, see refreshParser()
+    std::shared_ptr<ParserModel> parser;
+    uint64_t parser_generation = 0;
+    std::thread capture_thread;
+    std::thread processing_thread;
 
-  std::thread capture_thread_;
-  std::thread processing_thread_;
+    // Filled in by the thread itself, then published through tid; read-only afterwards
+    struct ThreadSlot {
+      ThreadPlacement placement;
+      std::atomic<pid_t> tid{0};
+    } capture_slot, processing_slot;
+    // One per ParserPool thread, empty when the processing thread parses itself
+    std::vector<std::unique_ptr<ThreadSlot>> parser_slots;
+
+    // Each group has a single writer thread, kept on its own cache line
+    struct alignas(64) CaptureCounters {
+      ThreadCounter captured;
+      ThreadCounter oversize;
+    } capture_counters;
+    struct alignas(64) ProcessingCounters {
+      ThreadCounter parsed;
+      ThreadCounter delivered;
+    } processing_counters;
+  };
+
+  std::vector<std::unique_ptr<CaptureWorker>> workers_;
+  std::unique_ptr<PacketMerger> merger_;
+  ThreadCounter merger_delivered_; // Written by the merger thread only
+  // Read and replaced with std::atomic_load / std::atomic_store only. parser_generation_ is bumped after each store,
+  // so processing threads poll one counter per batch and only load the pointer when it moved.
+  std::shared_ptr<ParserModel> parser_;
+  std::atomic<uint64_t> parser_generation_{0};
+  uint64_t session_generation_ = 0; // parser_generation_ when the session started
 
   std::atomic<bool> is_running_;
   std::atomic<bool> should_stop_;
   std::string last_error_;
+  ThreadSchedule capture_schedule_;
+  ThreadSchedule processing_schedule_;
+  ParseMode parse_mode_ = ParseMode::Eager;
 
   std::unique_ptr<PacketCallback> packet_callback_;
   std::mutex callback_mutex_;
 
-  void captureWorker();
-  void processingWorker();
-  void handleRawPacket(const uint8_t* data, size_t length);
+  // Guards workers_ against getStats() while a session starts or stops
+  std::mutex stats_mutex_;
+  CaptureStats finished_stats_;
+
+  bool compileFilter(const std::string& expression, CaptureOptions& capture_options);
+  bool createWorkers(const std::vector<std::string>& interface_names, const SnifferOptions& options);
+  bool createWorker(const std::string& interface_name, const SnifferOptions& options, int& fanout_group);
+  // Switches the worker to a clone of the parser published since its last batch, true if it did
+  bool refreshParser(CaptureWorker& worker);
+  void placeThread(CaptureWorker& worker, CaptureWorker::ThreadSlot& slot, const char* role,
+                   const ThreadSchedule& schedule);
+  void captureWorker(CaptureWorker& worker);
+  void processingWorker(CaptureWorker& worker);
+  void pooledProcessingWorker(CaptureWorker& worker);
+  void handleCapturedBatch(CaptureWorker& worker, const PacketView* packets, size_t count);
+  void processBatch(CaptureWorker& worker, const PacketView* packets, ParsedPacket* parsed_packets, size_t count);
+  // Parsed packets to the merger, or straight to the callback
+  void forwardBatch(CaptureWorker& worker, const PacketView* packets, ParsedPacket* parsed_packets, size_t count);
+  void deliverBatch(const PacketView* packets, const ParsedPacket* parsed_packets, size_t count,
+                    ThreadCounter& delivered);
+  // Placements are refreshed from the kernel only while the threads are alive
+  CaptureStats collectStats(bool threads_alive);
 };
@@ -1,34 +1,97 @@
 #pragma once
 
+#include "../parser/generated_parser.hpp"
 #include "../parser/packet_parser.hpp"
+#include "../utils/buffer/packet_pool.hpp"
 #include "./network_sniffer.hpp"
 #include <cstring>
 #include <memory>
+#include <mutex>
 #include <napi.h>
 #include <iostream>
+#include <vector>
 
 class NetworkSnifferWrapper;
 
+// Payload of one queued JS call, recycled so the parsed layers keep their storage from packet to packet
 struct CallbackData {
-  RawPacket raw;
+  PacketRef packet;
   ParsedPacket parsed;
 };
 
+// Idle payloads, shared with queued calls since those outlive the callback
+class CallbackDataPool {
+public:
+  ~CallbackDataPool() {
+    for (CallbackData* data : free_) {
+      delete data;
+    }
+  }
+
+  CallbackData* acquire() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!free_.empty()) {
+        CallbackData* data = free_.back();
+        free_.pop_back();
+        return data;
+      }
+    }
+    return new CallbackData();
+  }
+
+  // Drops the packet reference right away, the parsed storage waits for the next packet
+  void recycle(CallbackData* data) {
+    data->packet.reset();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (free_.size() < CALLBACK_POOL_SIZE) {
+        free_.push_back(data);
+        return;
+      }
+    }
+    delete data;
+  }
+
+private:
+  std::mutex mutex_;
+  std::vector<CallbackData*> free_;
+};
+
 class NapiPacketCallback : public PacketCallback {
 private:
   mutable Napi::ThreadSafeFunction tsfn_;
-  ParserModel* parser_;
 
-public:
-  NapiPacketCallback(Napi::ThreadSafeFunction tsfn, ParserModel* parser) : tsfn_(std::move(tsfn)), parser_(parser) {}
+  // Queued by the delivering thread, completed on the JS thread; shared since queued calls outlive the callback
+  mutable ThreadCounter queued_;
+  std::shared_ptr<ThreadCounter> completed_;
+  std::shared_ptr<CallbackDataPool> payloads_;
 
-  void operator()(const RawPacket& raw, const ParsedPacket& parsed) const override {
-    CallbackData* data = new CallbackData{raw, parsed};
+public:
+  explicit NapiPacketCallback(Napi::ThreadSafeFunction tsfn)
+      : tsfn_(std::move(tsfn)), completed_(std::make_shared<ThreadCounter>()),
+        payloads_(std::make_shared<CallbackDataPool>()) {}
+
+  uint64_t getBacklog() const override {
+    uint64_t completed = completed_->read();
+    uint64_t queued = queued_.read();
+    return queued > completed ? queued - completed : 0;
+  }
 
-    tsfn_.BlockingCall(data, [this](Napi::Env env, Napi::Function jsCallback, CallbackData* cb_data) {
+  void operator()(const PacketView& packet, const ParsedPacket& parsed) const override {
+    // JS runs later on its own thread: the bytes move to a pooled buffer (or gain a reference when the merger
+    // already put them in one) that the JS ArrayBuffer then wraps
+    CallbackData* data = payloads_->acquire();
+    data->packet = PacketPool::shared().share(packet);
+    data->parsed = parsed;
+    queued_.increment();
+
+    std::shared_ptr<ThreadCounter> completed = completed_;
+    std::shared_ptr<CallbackDataPool> payloads = payloads_;
+    napi_status status = tsfn_.BlockingCall(data, [completed, payloads](Napi::Env env, Napi::Function jsCallback, CallbackData* cb_data) {
       try {
-        Napi::Object raw_obj = cb_data->raw.toNapiObject(env);
-        Napi::Array parsed_arr = cb_data->parsed.toNapiArray(env);
+        Napi::Object raw_obj = cb_data->packet.toNapiObject(env);
+        Napi::Array parsed_arr = cb_data->parsed.toNapiArray(env, cb_data->packet);
 
         Napi::Object result = Napi::Object::New(env);
         result.Set("raw", raw_obj);
@@ -40,17 +103,69 @@ public:
       } catch (...) {
         std::cerr << "Unknown exception in N-API callback" << std::endl;
       }
-      delete cb_data;
+      payloads->recycle(cb_data);
+      completed->increment();
     });
+
+    // The function is closing, the call will never run
+    if (status != napi_ok) {
+      payloads_->recycle(data);
+      completed_->increment();
+    }
   };
 };
 
+// Loads the protocol files into a new parser on a libuv worker thread, then swaps it into the sniffer from the JS
+// thread. A running capture switches to it between batches; an entry file that fails to load keeps the current one.
+class ProtocolReloadWorker : public Napi::AsyncWorker {
+public:
+  ProtocolReloadWorker(const Napi::Object& receiver, NetworkSniffer* sniffer, std::string protocols_path,
+                       std::string parser_kind)
+      : Napi::AsyncWorker(receiver), deferred_(Napi::Promise::Deferred::New(receiver.Env())), sniffer_(sniffer),
+        protocols_path_(std::move(protocols_path)), parser_kind_(std::move(parser_kind)) {}
+
+  Napi::Promise GetPromise() const { return deferred_.Promise(); }
+
+protected:
+  void Execute() override {
+    std::shared_ptr<const ProtocolGraph> graph;
+    if (parser_kind_ == "generated") {
+      auto parser = std::make_unique<GeneratedParser>();
+      parser->setProtocolEntryFile(protocols_path_);
+      graph = parser->getGraph();
+      parser_ = std::move(parser);
+    } else {
+      auto parser = std::make_unique<PacketParser>();
+      parser->setProtocolEntryFile(protocols_path_);
+      graph = parser->getGraph();
+      parser_ = std::move(parser);
+    }
+
+    if (!graph || graph->entry() == nullptr) {
+      SetError("Could not load protocols from " + protocols_path_);
+    }
+  }
+
+  void OnOK() override {
+    sniffer_->setParser(std::move(parser_));
+    deferred_.Resolve(Env().Undefined());
+  }
+
+  void OnError(const Napi::Error& error) override { deferred_.Reject(error.Value()); }
+
+private:
+  Napi::Promise::Deferred deferred_;
+  NetworkSniffer* sniffer_; // Owned by the receiver, which the worker keeps alive
+  std::string protocols_path_;
+  std::string parser_kind_;
+  std::unique_ptr<ParserModel> parser_;
+};
+
 class NetworkSnifferWrapper : public Napi::ObjectWrap<NetworkSnifferWrapper> {
 public:
   static Napi::Object Init(Napi::Env env, Napi::Object exports);
   NetworkSnifferWrapper(const Napi::CallbackInfo& info);
   ~NetworkSnifferWrapper();
-  ParserModel* getParser() const;
 
 private:
   static Napi::FunctionReference constructor;
@@ -59,10 +174,17 @@ private:
   Napi::ThreadSafeFunction tsfn_;
   bool tsfn_active_ = false;
   std::string protocols_path_;
+  std::string parser_kind_ = "interpreted";
 
   Napi::Value StartSniffing(const Napi::CallbackInfo& info);
   Napi::Value StopSniffing(const Napi::CallbackInfo& info);
   Napi::Value IsRunning(const Napi::CallbackInfo& info);
+  Napi::Value GetStats(const Napi::CallbackInfo& info);
+  Napi::Value ReloadProtocols(const Napi::CallbackInfo& info);
+
+  bool ParseInterfaceNames(Napi::Env env, const Napi::Value& value, std::vector<std::string>& interface_names);
+  bool ParseSnifferOptions(Napi::Env env, const Napi::Value& value, SnifferOptions& options);
+  bool ParseThreadSchedule(Napi::Env env, const Napi::Object& obj, const char* key, ThreadSchedule& schedule);
 };
 
 // Implementation
@@ -77,6 +199,8 @@ Napi::Object NetworkSnifferWrapper::Init(Napi::Env env, Napi::Object exports) {
                                         InstanceMethod("startSniffing", &NetworkSnifferWrapper::StartSniffing),
                                         InstanceMethod("stopSniffing", &NetworkSnifferWrapper::StopSniffing),
                                         InstanceMethod("isRunning", &NetworkSnifferWrapper::IsRunning),
+                                        InstanceMethod("getStats", &NetworkSnifferWrapper::GetStats),
+                                        InstanceMethod("reloadProtocols", &NetworkSnifferWrapper::ReloadProtocols),
                                     });
 
   constructor = Napi::Persistent(func);
@@ -98,8 +222,25 @@ NetworkSnifferWrapper::NetworkSnifferWrapper(const Napi::CallbackInfo& info)
 
   protocols_path_ = info[0].As<Napi::String>().Utf8Value();
 
+  // 'interpreted' reads the protocol files at runtime, 'generated' runs the dissectors compiled from the bundled
+  // ones and interprets files that differ from them
+  if (info.Length() > 1 && !info[1].IsUndefined()) {
+    if (info[1].IsString()) {
+      parser_kind_ = info[1].As<Napi::String>().Utf8Value();
+    }
+    if (!info[1].IsString() || (parser_kind_ != "interpreted" && parser_kind_ != "generated")) {
+      Napi::TypeError::New(env, "Parser must be 'interpreted' or 'generated'").ThrowAsJavaScriptException();
+      return;
+    }
+  }
+
   sniffer_ = std::make_unique<NetworkSniffer>();
-  auto parser = std::make_unique<PacketParser>();
+  std::unique_ptr<ParserModel> parser;
+  if (parser_kind_ == "generated") {
+    parser = std::make_unique<GeneratedParser>();
+  } else {
+    parser = std::make_unique<PacketParser>();
+  }
   parser->setProtocolEntryFile(protocols_path_);
   sniffer_->setParser(std::move(parser));
 }
@@ -115,10 +256,6 @@ NetworkSnifferWrapper::~NetworkSnifferWrapper() {
   }
 }
 
-ParserModel* NetworkSnifferWrapper::getParser() const {
-  return sniffer_->getParser();
-}
-
 Napi::Value NetworkSnifferWrapper::StartSniffing(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
 
@@ -127,8 +264,8 @@ Napi::Value NetworkSnifferWrapper::StartSniffing(const Napi::CallbackInfo& info)
     return env.Undefined();
   }
 
-  if (!info[0].IsString()) {
-    Napi::TypeError::New(env, "First argument must be interface name string").ThrowAsJavaScriptException();
+  std::vector<std::string> interface_names;
+  if (!ParseInterfaceNames(env, info[0], interface_names)) {
     return env.Undefined();
   }
 
@@ -137,15 +274,19 @@ Napi::Value NetworkSnifferWrapper::StartSniffing(const Napi::CallbackInfo& info)
     return env.Undefined();
   }
 
-  std::string interface_name = info[0].As<Napi::String>().Utf8Value();
   Napi::Function callback = info[1].As<Napi::Function>();
 
+  SnifferOptions options;
+  if (info.Length() > 2 && !ParseSnifferOptions(env, info[2], options)) {
+    return env.Undefined();
+  }
+
   tsfn_ = Napi::ThreadSafeFunction::New(env, callback, "PacketCallback", 0, 1, [](Napi::Env) {});
   tsfn_active_ = true;
 
-  auto packet_callback = std::make_unique<NapiPacketCallback>(tsfn_, getParser());
+  auto packet_callback = std::make_unique<NapiPacketCallback>(tsfn_);
 
-  bool success = sniffer_->startSniffing(interface_name, std::move(packet_callback));
+  bool success = sniffer_->startSniffing(interface_names, std::move(packet_callback), options);
 
   if (!success) {
     tsfn_.Release();
@@ -176,4 +317,231 @@ Napi::Value NetworkSnifferWrapper::StopSniffing(const Napi::CallbackInfo& info)
 Napi::Value NetworkSnifferWrapper::IsRunning(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
   return Napi::Boolean::New(env, sniffer_->isRunning());
+}
+
+Napi::Value NetworkSnifferWrapper::GetStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  return sniffer_->getStats().toNapiObject(env);
+}
+
+Napi::Value NetworkSnifferWrapper::ReloadProtocols(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  // Same entry file as the current parser unless another one is given, which then sticks once it loads
+  std::string path = sniffer_->getParser()->getProtocolEntryFile();
+  if (info.Length() > 0 && !info[0].IsUndefined()) {
+    if (!info[0].IsString()) {
+      Napi::TypeError::New(env, "Protocols path must be a string").ThrowAsJavaScriptException();
+      return env.Undefined();
+    }
+    path = info[0].As<Napi::String>().Utf8Value();
+  }
+
+  auto* worker = new ProtocolReloadWorker(info.This().As<Napi::Object>(), sniffer_.get(), path, parser_kind_);
+  Napi::Promise promise = worker->GetPromise();
+  worker->Queue();
+  return promise;
+}
+
+bool NetworkSnifferWrapper::ParseInterfaceNames(Napi::Env env, const Napi::Value& value,
+                                                std::vector<std::string>& interface_names) {
+  if (value.IsString()) {
+    interface_names.push_back(value.As<Napi::String>().Utf8Value());
+    return true;
+  }
+
+  if (value.IsArray()) {
+    Napi::Array names = value.As<Napi::Array>();
+    for (uint32_t i = 0; i < names.Length(); i++) {
+      Napi::Value name = names.Get(i);
+      if (!name.IsString()) {
+        Napi::TypeError::New(env, "Interface names must be strings").ThrowAsJavaScriptException();
+        return false;
+      }
+      interface_names.push_back(name.As<Napi::String>().Utf8Value());
+    }
+    return true;
+  }
+
+  Napi::TypeError::New(env, "First argument must be an interface name or an array of names")
+      .ThrowAsJavaScriptException();
+  return false;
+}
+
+bool NetworkSnifferWrapper::ParseSnifferOptions(Napi::Env env, const Napi::Value& value, SnifferOptions& options) {
+  if (value.IsUndefined() || value.IsNull()) {
+    return true;
+  }
+
+  if (!value.IsObject()) {
+    Napi::TypeError::New(env, "Third argument must be an options object").ThrowAsJavaScriptException();
+    return false;
+  }
+
+  Napi::Object obj = value.As<Napi::Object>();
+
+  if (obj.Has("mode") && !obj.Get("mode").IsUndefined()) {
+    if (!obj.Get("mode").IsString()) {
+      Napi::TypeError::New(env, "Capture mode must be a string").ThrowAsJavaScriptException();
+      return false;
+    }
+    std::string mode = obj.Get("mode").As<Napi::String>().Utf8Value();
+    if (mode == "recv") {
+      options.capture.mode = CaptureMode::Recv;
+    } else if (mode == "ring") {
+      options.capture.mode = CaptureMode::RxRing;
+    } else if (mode == "xdp") {
+      options.capture.mode = CaptureMode::Xdp;
+    } else {
+      Napi::TypeError::New(env, "Capture mode must be 'recv', 'ring' or 'xdp'").ThrowAsJavaScriptException();
+      return false;
+    }
+  }
+
+  if (obj.Has("ringBlockSize") && obj.Get("ringBlockSize").IsNumber()) {
+    options.capture.ring_block_size = obj.Get("ringBlockSize").As<Napi::Number>().Uint32Value();
+  }
+
+  if (obj.Has("ringBlockCount") && obj.Get("ringBlockCount").IsNumber()) {
+    options.capture.ring_block_count = obj.Get("ringBlockCount").As<Napi::Number>().Uint32Value();
+  }
+
+  if (obj.Has("xdpQueue") && obj.Get("xdpQueue").IsNumber()) {
+    options.capture.xdp_queue = obj.Get("xdpQueue").As<Napi::Number>().Uint32Value();
+  }
+
+  if (obj.Has("xdpFrameCount") && obj.Get("xdpFrameCount").IsNumber()) {
+    options.capture.xdp_frame_count = obj.Get("xdpFrameCount").As<Napi::Number>().Uint32Value();
+  }
+
+  if (obj.Has("xdpGeneric") && obj.Get("xdpGeneric").IsBoolean()) {
+    options.capture.xdp_generic = obj.Get("xdpGeneric").As<Napi::Boolean>().Value();
+  }
+
+  if (obj.Has("snaplen") && obj.Get("snaplen").IsNumber()) {
+    options.capture.snaplen = obj.Get("snaplen").As<Napi::Number>().Uint32Value();
+  }
+
+  if (obj.Has("fanoutWorkers") && obj.Get("fanoutWorkers").IsNumber()) {
+    options.fanout_workers = obj.Get("fanoutWorkers").As<Napi::Number>().Uint32Value();
+  }
+
+  if (obj.Has("parserThreads") && obj.Get("parserThreads").IsNumber()) {
+    options.parser_threads = obj.Get("parserThreads").As<Napi::Number>().Uint32Value();
+  }
+
+  if (obj.Has("bufferBytes") && obj.Get("bufferBytes").IsNumber()) {
+    options.buffer_bytes = static_cast<size_t>(obj.Get("bufferBytes").As<Napi::Number>().Int64Value());
+  }
+
+  if (obj.Has("overflow") && !obj.Get("overflow").IsUndefined()) {
+    if (!obj.Get("overflow").IsString()) {
+      Napi::TypeError::New(env, "Overflow policy must be a string").ThrowAsJavaScriptException();
+      return false;
+    }
+    std::string overflow = obj.Get("overflow").As<Napi::String>().Utf8Value();
+    if (overflow == "drop-newest") {
+      options.overflow_policy = OverflowPolicy::DropNewest;
+    } else if (overflow == "drop-oldest") {
+      options.overflow_policy = OverflowPolicy::DropOldest;
+    } else if (overflow == "block") {
+      options.overflow_policy = OverflowPolicy::Block;
+    } else {
+      Napi::TypeError::New(env, "Overflow policy must be 'drop-newest', 'drop-oldest' or 'block'")
+          .ThrowAsJavaScriptException();
+      return false;
+    }
+  }
+
+  if (obj.Has("blockTimeoutMs") && obj.Get("blockTimeoutMs").IsNumber()) {
+    options.block_timeout = std::chrono::milliseconds(obj.Get("blockTimeoutMs").As<Napi::Number>().Int64Value());
+  }
+
+  if (obj.Has("waitStrategy") && !obj.Get("waitStrategy").IsUndefined()) {
+    if (!obj.Get("waitStrategy").IsString()) {
+      Napi::TypeError::New(env, "Wait strategy must be a string").ThrowAsJavaScriptException();
+      return false;
+    }
+    std::string wait_strategy = obj.Get("waitStrategy").As<Napi::String>().Utf8Value();
+    if (wait_strategy == "busy-spin") {
+      options.wait_strategy = WaitStrategy::BusySpin;
+    } else if (wait_strategy == "spin-yield") {
+      options.wait_strategy = WaitStrategy::SpinYield;
+    } else if (wait_strategy == "spin-park") {
+      options.wait_strategy = WaitStrategy::SpinPark;
+    } else {
+      Napi::TypeError::New(env, "Wait strategy must be 'busy-spin', 'spin-yield' or 'spin-park'")
+          .ThrowAsJavaScriptException();
+      return false;
+    }
+  }
+
+  if (obj.Has("parseMode") && !obj.Get("parseMode").IsUndefined()) {
+    if (!obj.Get("parseMode").IsString()) {
+      Napi::TypeError::New(env, "Parse mode must be a string").ThrowAsJavaScriptException();
+      return false;
+    }
+    std::string parse_mode = obj.Get("parseMode").As<Napi::String>().Utf8Value();
+    if (parse_mode == "eager") {
+      options.parse_mode = ParseMode::Eager;
+    } else if (parse_mode == "lazy") {
+      options.parse_mode = ParseMode::Lazy;
+    } else {
+      Napi::TypeError::New(env, "Parse mode must be 'eager' or 'lazy'").ThrowAsJavaScriptException();
+      return false;
+    }
+  }
+
+  if (obj.Has("filter") && !obj.Get("filter").IsUndefined()) {
+    if (!obj.Get("filter").IsString()) {
+      Napi::TypeError::New(env, "Capture filter must be a string").ThrowAsJavaScriptException();
+      return false;
+    }
+    options.filter = obj.Get("filter").As<Napi::String>().Utf8Value();
+  }
+
+  return ParseThreadSchedule(env, obj, "captureThread", options.capture_thread) &&
+         ParseThreadSchedule(env, obj, "processingThread", options.processing_thread);
+}
+
+bool NetworkSnifferWrapper::ParseThreadSchedule(Napi::Env env, const Napi::Object& obj, const char* key,
+                                                ThreadSchedule& schedule) {
+  if (!obj.Has(key) || obj.Get(key).IsUndefined()) {
+    return true;
+  }
+
+  if (!obj.Get(key).IsObject()) {
+    Napi::TypeError::New(env, std::string(key) + " must be an object").ThrowAsJavaScriptException();
+    return false;
+  }
+
+  Napi::Object thread = obj.Get(key).As<Napi::Object>();
+
+  if (thread.Has("cpus") && !thread.Get("cpus").IsUndefined()) {
+    if (!thread.Get("cpus").IsArray()) {
+      Napi::TypeError::New(env, std::string(key) + ".cpus must be an array of CPU numbers")
+          .ThrowAsJavaScriptException();
+      return false;
+    }
+    Napi::Array cpus = thread.Get("cpus").As<Napi::Array>();
+    for (uint32_t i = 0; i < cpus.Length(); i++) {
+      Napi::Value cpu = cpus.Get(i);
+      if (!cpu.IsNumber()) {
+        Napi::TypeError::New(env, std::string(key) + ".cpus must be an array of CPU numbers")
+            .ThrowAsJavaScriptException();
+        return false;
+      }
+      schedule.cpus.push_back(cpu.As<Napi::Number>().Int32Value());
+    }
+  }
+
+  if (thread.Has("fifoPriority") && thread.Get("fifoPriority").IsNumber()) {
+    schedule.fifo_priority = thread.Get("fifoPriority").As<Napi::Number>().Int32Value();
+  }
+
+  if (thread.Has("nice") && thread.Get("nice").IsNumber()) {
+    schedule.nice = thread.Get("nice").As<Napi::Number>().Int32Value();
+  }
+
+  return true;
 }
\ No newline at end of file
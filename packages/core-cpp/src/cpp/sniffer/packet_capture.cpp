@@ -1,52 +1,140 @@
 #include "packet_capture.hpp"
+#include "socket_filter.hpp"
+#include <algorithm>
 #include <arpa/inet.h>
-#include <chrono>
 #include <cstring>
 #include <errno.h>
 #include <fcntl.h>
 #include <iostream>
 #include <net/if.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/ioctl.h>
-#include <thread>
+#include <sys/mman.h>
 #include <unistd.h>
 
-PacketCapture::PacketCapture(const std::string& interface_name)
-    : interface_name_(interface_name), raw_socket_(-1), is_capturing_(false) {}
+namespace {
+
+PacketTimestamp toPacketTimestamp(int64_t seconds, int64_t nanoseconds) {
+  return PacketTimestamp(std::chrono::seconds(seconds) + std::chrono::nanoseconds(nanoseconds));
+}
+
+// SCM_TIMESTAMPNS and PACKET_AUXDATA from the control data, left untouched when the kernel attached none
+void readControlMessages(struct msghdr& message, PacketTimestamp& timestamp, size_t& original_length) {
+  for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&message); cmsg != nullptr; cmsg = CMSG_NXTHDR(&message, cmsg)) {
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+      struct timespec ts;
+      std::memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+      timestamp = toPacketTimestamp(ts.tv_sec, ts.tv_nsec);
+    } else if (cmsg->cmsg_level == SOL_PACKET && cmsg->cmsg_type == PACKET_AUXDATA) {
+      struct tpacket_auxdata aux;
+      std::memcpy(&aux, CMSG_DATA(cmsg), sizeof(aux));
+      original_length = aux.tp_len;
+    }
+  }
+}
+
+} // namespace
+
+PacketCapture::PacketCapture(const std::string& interface_name, const CaptureOptions& options)
+    : interface_name_(interface_name), options_(options), raw_socket_(-1), interface_index_(-1), epoll_fd_(-1),
+      stop_fd_(-1), is_capturing_(false), stop_requested_(false), fanout_group_(-1), rx_ring_(nullptr),
+      rx_ring_size_(0), kernel_received_(0), kernel_dropped_(0) {}
 
 PacketCapture::~PacketCapture() {
   stopCapture();
+  releaseRxRing();
+  closeDescriptors();
 }
 
 bool PacketCapture::initialize() {
+  if (options_.mode == CaptureMode::Xdp) {
+    if (setupXdp() && setupEventLoop()) {
+      return true;
+    }
+    std::cerr << "Warning: AF_XDP unavailable on " << interface_name_ << " (" << last_error_
+              << "), falling back to the TPACKET_V3 ring" << std::endl;
+    closeDescriptors();
+    last_error_.clear();
+    options_.mode = CaptureMode::RxRing;
+  }
+
   if (!createRawSocket()) {
     return false;
   }
 
-  if (!bindToInterface()) {
-    close(raw_socket_);
-    raw_socket_ = -1;
+  if (!buildFilterProgram().empty() && !attachFilter()) {
+    closeDescriptors();
+    return false;
+  }
+
+  // The ring has to exist before bind() so no frame lands in the regular receive queue
+  if (options_.mode == CaptureMode::RxRing && !setupRxRing()) {
+    std::cerr << "Warning: TPACKET_V3 ring unavailable on " << interface_name_ << ", falling back to recv()"
+              << std::endl;
+    options_.mode = CaptureMode::Recv;
+  }
+
+  if (!bindToInterface() || !setupEventLoop()) {
+    releaseRxRing();
+    closeDescriptors();
     return false;
   }
 
   return true;
 }
 
-bool PacketCapture::startCapture(const PacketHandler& handler) {
-  if (raw_socket_ == -1 || is_capturing_.load()) {
+bool PacketCapture::startCapture(const PacketHandler& handler, const BufferProvider& provider) {
+  if (captureDescriptor() == -1 || epoll_fd_ == -1 || is_capturing_.load() || stop_requested_.load()) {
     return false;
   }
 
   is_capturing_.store(true);
 
+  if (options_.mode == CaptureMode::Xdp) {
+    captureFromXdp(handler);
+  } else if (options_.mode == CaptureMode::RxRing) {
+    captureFromRing(handler);
+  } else {
+    captureFromSocket(handler, provider);
+  }
+
+  is_capturing_.store(false);
+  return true;
+}
+
+void PacketCapture::captureFromSocket(const PacketHandler& handler, const BufferProvider& provider) {
   uint8_t buffer[MAX_PACKET_SIZE];
+  alignas(struct cmsghdr) uint8_t control[CMSG_SPACE(sizeof(struct timespec)) +
+                                         CMSG_SPACE(sizeof(struct tpacket_auxdata))];
+  size_t snaplen = std::min<size_t>(options_.snaplen, sizeof(buffer));
+  struct iovec iov;
+  struct msghdr message;
   ssize_t packet_size;
 
-  while (is_capturing_.load()) {
-    packet_size = recv(raw_socket_, buffer, sizeof(buffer), 0);
+  while (!stop_requested_.load()) {
+    // Receiving into the consumer's buffer saves a copy, the stack buffer is the fallback when it is full
+    uint8_t* target = provider ? provider(snaplen) : nullptr;
+    iov.iov_base = target != nullptr ? target : buffer;
+    iov.iov_len = snaplen;
+
+    std::memset(&message, 0, sizeof(message));
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    // MSG_TRUNC reports the full frame size even when the buffer only got the first bytes
+    packet_size = recvmsg(raw_socket_, &message, MSG_TRUNC);
 
     if (packet_size < 0) {
       if (errno == EAGAIN || errno == EWOULDBLOCK) {
-        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        if (!waitReadable()) {
+          break;
+        }
+        continue;
+      }
+      if (errno == EINTR) {
         continue;
       }
       if (errno == EBADF || errno == ENOTSOCK) {
@@ -57,21 +145,168 @@ bool PacketCapture::startCapture(const PacketHandler& handler) {
     }
 
     if (packet_size > 0 && handler) {
-      handler(buffer, static_cast<size_t>(packet_size));
+      size_t original_length = static_cast<size_t>(packet_size);
+      PacketTimestamp timestamp =
+          std::chrono::time_point_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now());
+      readControlMessages(message, timestamp, original_length);
+
+      PacketView view = makeView(static_cast<uint8_t*>(iov.iov_base), std::min(static_cast<size_t>(packet_size), snaplen),
+                                 original_length, timestamp);
+      handler(&view, 1);
     }
   }
+}
 
-  is_capturing_.store(false);
+void PacketCapture::captureFromRing(const PacketHandler& handler) {
+  size_t block_index = 0;
+
+  while (!stop_requested_.load()) {
+    auto* block = reinterpret_cast<struct tpacket_block_desc*>(rx_ring_ + block_index * options_.ring_block_size);
+
+    if ((__atomic_load_n(&block->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER) == 0) {
+      if (!waitReadable()) {
+        break;
+      }
+      continue;
+    }
+
+    walkRingBlock(block, handler);
+
+    // Hand the whole block back to the kernel in one store
+    __atomic_store_n(&block->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+    block_index = (block_index + 1) % options_.ring_block_count;
+  }
+}
+
+void PacketCapture::walkRingBlock(struct tpacket_block_desc* block, const PacketHandler& handler) {
+  uint8_t* block_start = reinterpret_cast<uint8_t*>(block);
+  uint32_t packet_count = block->hdr.bh1.num_pkts;
+  auto* header = reinterpret_cast<struct tpacket3_hdr*>(block_start + block->hdr.bh1.offset_to_first_pkt);
+
+  // Frames stay in the block until it is handed back, so they are passed on by reference in batches
+  PacketView batch[CAPTURE_BATCH_SIZE];
+  size_t batch_count = 0;
+
+  for (uint32_t i = 0; i < packet_count; i++) {
+    if (handler && header->tp_snaplen > 0) {
+      batch[batch_count++] = makeView(reinterpret_cast<uint8_t*>(header) + header->tp_mac,
+                                      std::min(header->tp_snaplen, options_.snaplen), header->tp_len,
+                                      toPacketTimestamp(header->tp_sec, header->tp_nsec));
+      if (batch_count == CAPTURE_BATCH_SIZE) {
+        handler(batch, batch_count);
+        batch_count = 0;
+      }
+    }
+    header = reinterpret_cast<struct tpacket3_hdr*>(reinterpret_cast<uint8_t*>(header) + header->tp_next_offset);
+  }
+
+  if (batch_count > 0) {
+    handler(batch, batch_count);
+  }
+}
+
+PacketView PacketCapture::makeView(const uint8_t* data, size_t length, size_t original_length,
+                                   PacketTimestamp timestamp) const {
+  PacketView view;
+  view.data = data;
+  view.length = length;
+  view.original_length = original_length;
+  view.interface_index = interface_index_;
+  view.timestamp = timestamp;
+  return view;
+}
+
+bool PacketCapture::setupXdp() {
+  int interface_index = static_cast<int>(if_nametoindex(interface_name_.c_str()));
+  if (interface_index == 0) {
+    last_error_ = std::string("Unknown interface ") + interface_name_ + ": " + strerror(errno);
+    return false;
+  }
+
+  auto xdp_socket = std::make_unique<XdpSocket>();
+  if (!xdp_socket->open(interface_index, options_.xdp_queue, options_.xdp_frame_count, options_.xdp_generic,
+                         last_error_)) {
+    return false;
+  }
+
+  std::cerr << "Warning: AF_XDP capture takes RX queue " << options_.xdp_queue << " of " << interface_name_
+            << " away from the kernel stack until it stops" << std::endl;
+  if (xdp_socket->isGenericMode() && !options_.xdp_generic) {
+    std::cerr << "Warning: " << interface_name_ << " has no native XDP support, using generic (skb) mode"
+              << std::endl;
+  }
+
+  interface_index_ = interface_index;
+  xdp_filter_ = buildFilterProgram();
+  xdp_socket_ = std::move(xdp_socket);
   return true;
 }
 
+void PacketCapture::captureFromXdp(const PacketHandler& handler) {
+  auto frame_handler = [this, &handler](const XdpSocket::Frame* frames, size_t count) {
+    xdp_received_.increment(count);
+    if (!handler) {
+      return;
+    }
+
+    // One clock read per batch, the frames arrived together
+    PacketTimestamp timestamp = std::chrono::time_point_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now());
+    PacketView batch[CAPTURE_BATCH_SIZE];
+    size_t batch_count = 0;
+
+    for (size_t i = 0; i < count; i++) {
+      uint32_t keep = runSocketFilter(xdp_filter_, frames[i].data, frames[i].length);
+      if (keep != 0) {
+        batch[batch_count++] = makeView(frames[i].data, std::min<size_t>({frames[i].length, keep, options_.snaplen}),
+                                        frames[i].length, timestamp);
+      }
+    }
+
+    if (batch_count > 0) {
+      handler(batch, batch_count);
+    }
+  };
+
+  while (!stop_requested_.load()) {
+    if (xdp_socket_->receive(frame_handler) == 0 && !waitReadable()) {
+      break;
+    }
+  }
+}
+
+bool PacketCapture::waitReadable() {
+  struct epoll_event events[2];
+
+  while (!stop_requested_.load()) {
+    int ready = epoll_wait(epoll_fd_, events, 2, -1);
+
+    if (ready < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      std::cerr << "Error waiting for packets: " << strerror(errno) << std::endl;
+      return false;
+    }
+
+    for (int i = 0; i < ready; i++) {
+      if (events[i].data.fd == stop_fd_) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  return false;
+}
+
 void PacketCapture::stopCapture() {
-  is_capturing_.store(false);
+  stop_requested_.store(true);
 
-  if (raw_socket_ != -1) {
-    shutdown(raw_socket_, SHUT_RDWR);
-    close(raw_socket_);
-    raw_socket_ = -1;
+  // Wakes the capture thread out of epoll_wait, descriptors are closed once it has returned
+  if (stop_fd_ != -1) {
+    uint64_t value = 1;
+    ssize_t written = write(stop_fd_, &value, sizeof(value));
+    (void)written;
   }
 }
 
@@ -79,6 +314,78 @@ bool PacketCapture::isCapturing() const {
   return is_capturing_.load();
 }
 
+bool PacketCapture::joinFanoutGroup(int group_id) {
+  // Hash mode keeps every packet of a flow on the same socket, defrag keeps IP fragments together
+  int type_flags = PACKET_FANOUT_HASH | PACKET_FANOUT_FLAG_DEFRAG;
+  int id = group_id;
+
+  if (group_id < 0) {
+    type_flags |= PACKET_FANOUT_FLAG_UNIQUEID;
+    id = 0;
+  }
+
+  int fanout_arg = (id & 0xffff) | (type_flags << 16);
+  if (setsockopt(raw_socket_, SOL_PACKET, PACKET_FANOUT, &fanout_arg, sizeof(fanout_arg)) < 0) {
+    last_error_ = std::string("Error joining PACKET_FANOUT group on ") + interface_name_ + ": " + strerror(errno);
+    std::cerr << last_error_ << std::endl;
+    return false;
+  }
+
+  if (group_id < 0) {
+    socklen_t arg_length = sizeof(fanout_arg);
+    if (getsockopt(raw_socket_, SOL_PACKET, PACKET_FANOUT, &fanout_arg, &arg_length) < 0) {
+      last_error_ = std::string("Error reading PACKET_FANOUT group id: ") + strerror(errno);
+      std::cerr << last_error_ << std::endl;
+      return false;
+    }
+    id = fanout_arg & 0xffff;
+  }
+
+  fanout_group_ = id;
+  return true;
+}
+
+int PacketCapture::getFanoutGroup() const {
+  return fanout_group_;
+}
+
+int PacketCapture::getBoundInterfaceIndex() const {
+  return interface_index_;
+}
+
+CaptureMode PacketCapture::getCaptureMode() const {
+  return options_.mode;
+}
+
+bool PacketCapture::readKernelStats(uint64_t& received, uint64_t& dropped) {
+  std::lock_guard<std::mutex> lock(kernel_stats_mutex_);
+
+  // AF_XDP drop counters are cumulative and the kernel has no receive count, frames read stand in for it
+  uint64_t xdp_dropped = 0;
+  if (xdp_socket_ && xdp_socket_->readDropCount(xdp_dropped)) {
+    kernel_dropped_ = xdp_dropped;
+    kernel_received_ = xdp_received_.read() + xdp_dropped;
+  } else if (raw_socket_ != -1) {
+    // TPACKET_V3 sockets answer with the larger v3 struct, whose prefix matches tpacket_stats
+    struct tpacket_stats_v3 stats;
+    std::memset(&stats, 0, sizeof(stats));
+    socklen_t length = options_.mode == CaptureMode::RxRing ? sizeof(struct tpacket_stats_v3)
+                                                            : sizeof(struct tpacket_stats);
+
+    if (getsockopt(raw_socket_, SOL_PACKET, PACKET_STATISTICS, &stats, &length) < 0) {
+      last_error_ = std::string("Error reading PACKET_STATISTICS: ") + strerror(errno);
+      return false;
+    }
+
+    kernel_received_ += stats.tp_packets;
+    kernel_dropped_ += stats.tp_drops;
+  }
+
+  received = kernel_received_;
+  dropped = kernel_dropped_;
+  return true;
+}
+
 bool PacketCapture::createRawSocket() {
   raw_socket_ = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
 
@@ -97,6 +404,15 @@ bool PacketCapture::createRawSocket() {
     std::cerr << "Warning: Could not set socket to non-blocking mode" << std::endl;
   }
 
+  // Ring frames always carry tp_sec/tp_nsec and tp_len, recv() needs them as control messages
+  int enable = 1;
+  if (setsockopt(raw_socket_, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable)) < 0) {
+    std::cerr << "Warning: SO_TIMESTAMPNS unavailable, falling back to user-space timestamps" << std::endl;
+  }
+  if (setsockopt(raw_socket_, SOL_PACKET, PACKET_AUXDATA, &enable, sizeof(enable)) < 0) {
+    std::cerr << "Warning: PACKET_AUXDATA unavailable, truncated frames report their captured length" << std::endl;
+  }
+
   return true;
 }
 
@@ -113,9 +429,48 @@ int PacketCapture::getInterfaceIndex() {
   return ifr.ifr_ifindex;
 }
 
+std::vector<struct sock_filter> PacketCapture::buildFilterProgram() const {
+  if (options_.filter.empty() && options_.snaplen >= MAX_PACKET_SIZE) {
+    return {};
+  }
+
+  // The accept value of a socket filter is the number of bytes kept, clamp it to the snap length
+  std::vector<struct sock_filter> instructions = options_.filter;
+  if (instructions.empty()) {
+    instructions.push_back(BPF_STMT(BPF_RET | BPF_K, options_.snaplen));
+  }
+  for (struct sock_filter& instruction : instructions) {
+    if (instruction.code == (BPF_RET | BPF_K) && instruction.k > options_.snaplen) {
+      instruction.k = options_.snaplen;
+    }
+  }
+  return instructions;
+}
+
+bool PacketCapture::attachFilter() {
+  std::vector<struct sock_filter> instructions = buildFilterProgram();
+
+  struct sock_fprog program;
+  program.len = static_cast<unsigned short>(instructions.size());
+  program.filter = instructions.data();
+
+  if (setsockopt(raw_socket_, SOL_SOCKET, SO_ATTACH_FILTER, &program, sizeof(program)) < 0) {
+    last_error_ = "Failed to attach capture filter: " + std::string(strerror(errno));
+    return false;
+  }
+
+  // Frames queued before the filter was attached bypassed it, drop them
+  uint8_t scratch[1];
+  while (recv(raw_socket_, scratch, sizeof(scratch), MSG_DONTWAIT | MSG_TRUNC) >= 0) {
+  }
+
+  return true;
+}
+
 bool PacketCapture::bindToInterface() {
   int interface_index = getInterfaceIndex();
   if (interface_index < 0) {
+    last_error_ = std::string("Unknown interface ") + interface_name_ + ": " + strerror(errno);
     return false;
   }
 
@@ -131,9 +486,112 @@ bool PacketCapture::bindToInterface() {
     return false;
   }
 
+  interface_index_ = interface_index;
+  return true;
+}
+
+bool PacketCapture::setupEventLoop() {
+  stop_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (stop_fd_ < 0) {
+    last_error_ = std::string("Error creating stop eventfd: ") + strerror(errno);
+    std::cerr << last_error_ << std::endl;
+    return false;
+  }
+
+  epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_fd_ < 0) {
+    last_error_ = std::string("Error creating epoll instance: ") + strerror(errno);
+    std::cerr << last_error_ << std::endl;
+    return false;
+  }
+
+  struct epoll_event socket_event;
+  memset(&socket_event, 0, sizeof(socket_event));
+  socket_event.events = EPOLLIN;
+  socket_event.data.fd = captureDescriptor();
+
+  struct epoll_event stop_event;
+  memset(&stop_event, 0, sizeof(stop_event));
+  stop_event.events = EPOLLIN;
+  stop_event.data.fd = stop_fd_;
+
+  if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, captureDescriptor(), &socket_event) < 0 ||
+      epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, stop_fd_, &stop_event) < 0) {
+    last_error_ = std::string("Error registering capture descriptors: ") + strerror(errno);
+    std::cerr << last_error_ << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+int PacketCapture::captureDescriptor() const {
+  return xdp_socket_ ? xdp_socket_->getDescriptor() : raw_socket_;
+}
+
+void PacketCapture::closeDescriptors() {
+  if (epoll_fd_ != -1) {
+    close(epoll_fd_);
+    epoll_fd_ = -1;
+  }
+
+  if (stop_fd_ != -1) {
+    close(stop_fd_);
+    stop_fd_ = -1;
+  }
+
+  if (raw_socket_ != -1) {
+    shutdown(raw_socket_, SHUT_RDWR);
+    close(raw_socket_);
+    raw_socket_ = -1;
+  }
+
+  xdp_socket_.reset();
+}
+
+bool PacketCapture::setupRxRing() {
+  int version = TPACKET_V3;
+  if (setsockopt(raw_socket_, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0) {
+    std::cerr << "Error selecting TPACKET_V3: " << strerror(errno) << std::endl;
+    return false;
+  }
+
+  struct tpacket_req3 req;
+  memset(&req, 0, sizeof(req));
+  req.tp_block_size = options_.ring_block_size;
+  req.tp_block_nr = options_.ring_block_count;
+  req.tp_frame_size = RX_RING_FRAME_SIZE;
+  req.tp_frame_nr = (options_.ring_block_size / RX_RING_FRAME_SIZE) * options_.ring_block_count;
+  req.tp_retire_blk_tov = RX_RING_BLOCK_TIMEOUT_MS;
+
+  if (setsockopt(raw_socket_, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0) {
+    std::cerr << "Error configuring PACKET_RX_RING: " << strerror(errno) << std::endl;
+    return false;
+  }
+
+  size_t ring_size = static_cast<size_t>(options_.ring_block_size) * options_.ring_block_count;
+  void* ring = mmap(nullptr, ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, raw_socket_, 0);
+  if (ring == MAP_FAILED) {
+    std::cerr << "Error mapping capture ring: " << strerror(errno) << std::endl;
+    // Tear the ring down again, otherwise frames keep going to it instead of the receive queue
+    memset(&req, 0, sizeof(req));
+    setsockopt(raw_socket_, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req));
+    return false;
+  }
+
+  rx_ring_ = static_cast<uint8_t*>(ring);
+  rx_ring_size_ = ring_size;
   return true;
 }
 
+void PacketCapture::releaseRxRing() {
+  if (rx_ring_ != nullptr) {
+    munmap(rx_ring_, rx_ring_size_);
+    rx_ring_ = nullptr;
+    rx_ring_size_ = 0;
+  }
+}
+
 const std::string& PacketCapture::getLastError() const {
   return last_error_;
 }
\ No newline at end of file
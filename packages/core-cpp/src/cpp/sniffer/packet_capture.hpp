@@ -1,34 +1,112 @@
 #pragma once
 
 #include "../utils/packets/packet_model.hpp"
+#include "../utils/stats/capture_stats.hpp"
+#include "./xdp_socket.hpp"
 #include <atomic>
 #include <functional>
+#include <mutex>
+#include <linux/filter.h>
 #include <linux/if_packet.h>
+#include <memory>
 #include <net/ethernet.h>
 #include <string>
 #include <sys/socket.h>
+#include <vector>
 
-using PacketHandler = std::function<void(const uint8_t* packet_data, size_t length)>;
+// Up to CAPTURE_BATCH_SIZE frames at once; their data is only valid until the handler returns
+using PacketHandler = std::function<void(const PacketView* packets, size_t count)>;
+// Where recv() mode should receive the next frame (up to capacity bytes), null to use the capture's own buffer
+using BufferProvider = std::function<uint8_t*(size_t capacity)>;
+
+enum class CaptureMode {
+  Recv,  // One recv() per frame on the raw socket
+  RxRing, // PACKET_RX_RING / TPACKET_V3 memory-mapped block ring
+  Xdp     // AF_XDP socket on one RX queue, frames read in place from the UMEM; user-space timestamps. Frames on
+          // that queue no longer reach the kernel stack while capturing.
+};
+
+struct CaptureOptions {
+  CaptureMode mode = CaptureMode::Recv;
+  uint32_t ring_block_size = RX_RING_BLOCK_SIZE;
+  uint32_t ring_block_count = RX_RING_BLOCK_COUNT;
+  // Bytes kept per frame, the kernel truncates before copying to the socket or ring
+  uint32_t snaplen = MAX_PACKET_SIZE;
+  uint32_t xdp_queue = 0;
+  uint32_t xdp_frame_count = XDP_FRAME_COUNT;
+  // Attach in generic (skb) mode even where the driver has a native XDP hook
+  bool xdp_generic = false;
+  // Classic BPF program attached with SO_ATTACH_FILTER, empty captures everything
+  std::vector<struct sock_filter> filter;
+};
 
 class PacketCapture {
 public:
-  explicit PacketCapture(const std::string& interface_name);
+  explicit PacketCapture(const std::string& interface_name, const CaptureOptions& options = CaptureOptions());
   ~PacketCapture();
 
   bool initialize();
-  bool startCapture(const PacketHandler& handler);
+  bool startCapture(const PacketHandler& handler, const BufferProvider& provider = BufferProvider());
   void stopCapture();
   bool isCapturing() const;
 
+  // Joins a PACKET_FANOUT hash group, group_id < 0 asks the kernel for a fresh unique id
+  bool joinFanoutGroup(int group_id);
+  int getFanoutGroup() const;
+
+  // Kernel ifindex the socket is bound to, -1 before initialize()
+  int getBoundInterfaceIndex() const;
+
+  // Mode actually in use: Xdp falls back to RxRing, RxRing to Recv, when the kernel refuses them
+  CaptureMode getCaptureMode() const;
+
+  // PACKET_STATISTICS totals since initialize(); the kernel resets its counters on every read
+  bool readKernelStats(uint64_t& received, uint64_t& dropped);
+
   const std::string& getLastError() const;
 
 private:
   std::string interface_name_;
+  CaptureOptions options_;
   int raw_socket_;
+  int interface_index_;
+  int epoll_fd_;
+  int stop_fd_;
   std::atomic<bool> is_capturing_;
+  std::atomic<bool> stop_requested_;
   std::string last_error_;
+  int fanout_group_;
+
+  uint8_t* rx_ring_;
+  size_t rx_ring_size_;
+
+  std::unique_ptr<XdpSocket> xdp_socket_;
+  std::vector<struct sock_filter> xdp_filter_; // Run in user space, AF_XDP sockets take no socket filter
+  ThreadCounter xdp_received_;
+
+  std::mutex kernel_stats_mutex_;
+  uint64_t kernel_received_;
+  uint64_t kernel_dropped_;
 
   bool createRawSocket();
+  std::vector<struct sock_filter> buildFilterProgram() const;
+  bool attachFilter();
+  int captureDescriptor() const;
   int getInterfaceIndex();
   bool bindToInterface();
+  bool setupEventLoop();
+  void closeDescriptors();
+
+  // Blocks until the socket is readable, returns false once stopCapture() fired
+  bool waitReadable();
+
+  bool setupRxRing();
+  void releaseRxRing();
+  void captureFromSocket(const PacketHandler& handler, const BufferProvider& provider);
+  void captureFromRing(const PacketHandler& handler);
+
+  bool setupXdp();
+  void captureFromXdp(const PacketHandler& handler);
+  void walkRingBlock(struct tpacket_block_desc* block, const PacketHandler& handler);
+  PacketView makeView(const uint8_t* data, size_t length, size_t original_length, PacketTimestamp timestamp) const;
 };
@@ -0,0 +1,88 @@
+#include "packet_merger.hpp"
+
+PacketMerger::PacketMerger(size_t source_count, MergeSink sink, std::chrono::microseconds reorder_window)
+    : queues_(source_count), sink_(std::move(sink)), reorder_window_(reorder_window), stopping_(false) {}
+
+PacketMerger::~PacketMerger() {
+  stop();
+}
+
+void PacketMerger::start() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (thread_.joinable()) {
+    return;
+  }
+  stopping_ = false;
+  thread_ = std::thread(&PacketMerger::run, this);
+}
+
+void PacketMerger::push(size_t source, const PacketView& packet, ParsedPacket&& parsed) {
+  PacketRef kept = PacketPool::shared().share(packet);
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  std::deque<Entry>& queue = queues_[source];
+
+  space_cv_.wait(lock, [&] { return stopping_ || queue.size() < MERGE_QUEUE_DEPTH; });
+
+  bool was_empty = queue.empty();
+  queue.push_back(Entry{std::move(kept), std::move(parsed), std::chrono::steady_clock::now()});
+
+  // The merge thread only needs waking when a new head appears
+  if (was_empty) {
+    data_cv_.notify_one();
+  }
+}
+
+void PacketMerger::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  data_cv_.notify_all();
+  space_cv_.notify_all();
+
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void PacketMerger::run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  while (true) {
+    size_t best = queues_.size();
+    bool all_sources_ready = true;
+
+    for (size_t i = 0; i < queues_.size(); i++) {
+      if (queues_[i].empty()) {
+        all_sources_ready = false;
+        continue;
+      }
+      if (best == queues_.size() || queues_[i].front().packet->timestamp < queues_[best].front().packet->timestamp) {
+        best = i;
+      }
+    }
+
+    if (best == queues_.size()) {
+      if (stopping_) {
+        break;
+      }
+      data_cv_.wait(lock);
+      continue;
+    }
+
+    auto deadline = queues_[best].front().arrival + reorder_window_;
+    if (!all_sources_ready && !stopping_ && std::chrono::steady_clock::now() < deadline) {
+      data_cv_.wait_until(lock, deadline);
+      continue;
+    }
+
+    Entry entry = std::move(queues_[best].front());
+    queues_[best].pop_front();
+    space_cv_.notify_all();
+
+    lock.unlock();
+    sink_(entry.packet.view(), entry.parsed);
+    lock.lock();
+  }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "../parser/parser_model.hpp"
+#include "../utils/buffer/packet_pool.hpp"
+#include "../utils/packets/packet_model.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// The packet's view names its pooled buffer, a sink that keeps it can take a reference instead of a copy
+using MergeSink = std::function<void(const PacketView& packet, const ParsedPacket& parsed)>;
+
+// Merges several per-worker packet streams, each already in timestamp order, back into one
+// globally ordered stream. A head is released once every source has something queued, or once
+// it has waited longer than the reorder window (so an idle source cannot stall the others).
+class PacketMerger {
+public:
+  PacketMerger(size_t source_count, MergeSink sink,
+               std::chrono::microseconds reorder_window = std::chrono::microseconds(MERGE_REORDER_WINDOW_US));
+  ~PacketMerger();
+
+  void start();
+  // Blocks while the source queue is full so a slow sink back-pressures the workers
+  // The packet goes to a pooled buffer, it has to outlive the caller's view while it waits for the other sources
+  void push(size_t source, const PacketView& packet, ParsedPacket&& parsed);
+  // Delivers everything still queued, in order, then joins the merge thread
+  void stop();
+
+private:
+  struct Entry {
+    PacketRef packet;
+    ParsedPacket parsed;
+    std::chrono::steady_clock::time_point arrival;
+  };
+
+  std::vector<std::deque<Entry>> queues_;
+  MergeSink sink_;
+  std::chrono::microseconds reorder_window_;
+
+  std::mutex mutex_;
+  std::condition_variable data_cv_;
+  std::condition_variable space_cv_;
+  bool stopping_;
+  std::thread thread_;
+
+  void run();
+};
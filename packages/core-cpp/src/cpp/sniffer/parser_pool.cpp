@@ -0,0 +1,117 @@
+#include "parser_pool.hpp"
+#include <algorithm>
+
+ParserPool::ParserPool(const ParserModel& parser, size_t thread_count, ParseMode mode, ParserThreadInit init)
+    : slots_(thread_count * PARSER_POOL_BATCHES_PER_THREAD), mode_(mode), init_(std::move(init)) {
+  for (Slot& slot : slots_) {
+    slot.refs.resize(PROCESSING_BATCH_SIZE);
+    slot.packets.resize(PROCESSING_BATCH_SIZE);
+    slot.parsed.resize(PROCESSING_BATCH_SIZE);
+  }
+
+  for (size_t i = 0; i < thread_count; i++) {
+    parsers_.push_back(parser.clone());
+  }
+  pending_parsers_.resize(thread_count);
+  for (size_t i = 0; i < thread_count; i++) {
+    threads_.emplace_back(&ParserPool::run, this, i);
+  }
+}
+
+ParserPool::~ParserPool() {
+  stop();
+}
+
+void ParserPool::submit(const PacketView* packets, size_t count) {
+  Slot& batch = slot(next_submit_);
+  count = std::min(count, PROCESSING_BATCH_SIZE);
+  for (size_t i = 0; i < count; i++) {
+    batch.refs[i] = PacketPool::shared().share(packets[i]);
+    batch.packets[i] = batch.refs[i].view();
+  }
+  batch.count = count;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    next_submit_++;
+  }
+  work_cv_.notify_one();
+}
+
+size_t ParserPool::deliver(const ParsedBatchSink& sink, bool wait) {
+  size_t delivered = 0;
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  if (wait && next_deliver_ < next_submit_) {
+    done_cv_.wait(lock, [this] { return stopping_ || slot(next_deliver_).parsed_done; });
+  }
+
+  while (next_deliver_ < next_submit_ && slot(next_deliver_).parsed_done) {
+    Slot& batch = slot(next_deliver_);
+    lock.unlock();
+
+    sink(batch.packets.data(), batch.parsed.data(), batch.count);
+    delivered += batch.count;
+    for (size_t i = 0; i < batch.count; i++) {
+      batch.refs[i].reset();
+    }
+
+    lock.lock();
+    batch.parsed_done = false;
+    next_deliver_++;
+  }
+  return delivered;
+}
+
+void ParserPool::setParser(const ParserModel& parser) {
+  // Cloned outside the lock, parser threads only wait for the swap itself
+  std::vector<std::unique_ptr<ParserModel>> clones;
+  for (size_t i = 0; i < threads_.size(); i++) {
+    clones.push_back(parser.clone());
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  pending_parsers_.swap(clones);
+}
+
+void ParserPool::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  work_cv_.notify_all();
+  done_cv_.notify_all();
+
+  for (std::thread& thread : threads_) {
+    if (thread.joinable()) {
+      thread.join();
+    }
+  }
+}
+
+void ParserPool::run(size_t thread_index) {
+  if (init_) {
+    init_(thread_index);
+  }
+  std::unique_ptr<ParserModel>& parser = parsers_[thread_index];
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    work_cv_.wait(lock, [this] { return stopping_ || next_parse_ < next_submit_; });
+    if (stopping_) {
+      break;
+    }
+
+    Slot& batch = slot(next_parse_++);
+    std::unique_ptr<ParserModel> pending = std::move(pending_parsers_[thread_index]);
+    lock.unlock();
+    if (pending) {
+      parser = std::move(pending);
+    }
+    parser->parseBatch(batch.packets.data(), batch.parsed.data(), batch.count, mode_);
+    lock.lock();
+
+    batch.parsed_done = true;
+    done_cv_.notify_one();
+  }
+}
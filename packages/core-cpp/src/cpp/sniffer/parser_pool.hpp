@@ -0,0 +1,74 @@
+#pragma once
+
+#include "../parser/parser_model.hpp"
+#include "../utils/buffer/packet_pool.hpp"
+#include "../utils/packets/packet_model.hpp"
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// One parsed batch in submission order; each view names its pooled buffer so a sink can keep a reference
+using ParsedBatchSink = std::function<void(const PacketView* packets, ParsedPacket* parsed, size_t count)>;
+// Run by each parser thread before it takes any work, e.g. to apply a ThreadSchedule
+using ParserThreadInit = std::function<void(size_t thread_index)>;
+
+// Parses batches on several threads, each with its own clone of the parser, and hands them back in the order
+// they were submitted. Each batch takes the next sequence number and the reorder buffer slot it maps to; parser
+// threads claim batches in sequence order and the owner delivers the head slot once it is parsed.
+// submit(), deliver(), isFull() and isIdle() belong to a single owner thread.
+class ParserPool {
+public:
+  ParserPool(const ParserModel& parser, size_t thread_count, ParseMode mode, ParserThreadInit init = nullptr);
+  ~ParserPool();
+
+  ParserPool(const ParserPool&) = delete;
+  ParserPool& operator=(const ParserPool&) = delete;
+
+  // Copies the packets to pooled buffers, so the caller can release its own right away. Needs a free slot.
+  void submit(const PacketView* packets, size_t count);
+  // Hands every parsed batch at the head of the sequence to sink. With wait, first blocks until the oldest
+  // batch in flight is parsed. Returns the number of packets delivered.
+  size_t deliver(const ParsedBatchSink& sink, bool wait);
+  // Every slot holds a batch not delivered yet
+  bool isFull() const { return next_submit_ - next_deliver_ == slots_.size(); }
+  bool isIdle() const { return next_submit_ == next_deliver_; }
+  size_t getThreadCount() const { return threads_.size(); }
+  // Batches claimed from now on are parsed with clones of parser; each thread swaps its own in between batches
+  void setParser(const ParserModel& parser);
+  // Joins the parser threads; batches not delivered yet are dropped
+  void stop();
+
+private:
+  struct Slot {
+    std::vector<PacketRef> refs;
+    std::vector<PacketView> packets;
+    std::vector<ParsedPacket> parsed;
+    size_t count = 0;
+    bool parsed_done = false; // Guarded by mutex_
+  };
+
+  std::vector<Slot> slots_;
+  std::vector<std::unique_ptr<ParserModel>> parsers_; // By thread, only touched by that thread once it runs
+  std::vector<std::unique_ptr<ParserModel>> pending_parsers_; // By thread, guarded by mutex_
+  std::vector<std::thread> threads_;
+  ParseMode mode_;
+  ParserThreadInit init_;
+
+  // Sequence numbers, batch n lives in slots_[n % slots_.size()]. Written under mutex_, the owner also reads
+  // next_submit_ and next_deliver_ without it since it is their only writer.
+  uint64_t next_submit_ = 0;
+  uint64_t next_parse_ = 0;
+  uint64_t next_deliver_ = 0;
+
+  std::mutex mutex_;
+  std::condition_variable work_cv_;
+  std::condition_variable done_cv_;
+  bool stopping_ = false;
+
+  Slot& slot(uint64_t sequence) { return slots_[sequence % slots_.size()]; }
+  void run(size_t thread_index);
+};
@@ -0,0 +1,129 @@
+#include "socket_filter.hpp"
+
+namespace {
+
+// Big-endian load of size bytes at offset, false when it runs past the frame (the kernel drops the frame then)
+bool loadBytes(const uint8_t* packet, size_t length, uint64_t offset, uint32_t size, uint32_t& value) {
+  if (offset + size > length) {
+    return false;
+  }
+  value = 0;
+  for (uint32_t i = 0; i < size; i++) {
+    value = (value << 8) | packet[offset + i];
+  }
+  return true;
+}
+
+uint32_t loadSize(uint16_t code) {
+  switch (BPF_SIZE(code)) {
+    case BPF_W: return 4;
+    case BPF_H: return 2;
+    default: return 1;
+  }
+}
+
+} // namespace
+
+uint32_t runSocketFilter(const std::vector<struct sock_filter>& program, const uint8_t* packet, size_t length) {
+  if (program.empty()) {
+    return UINT32_MAX;
+  }
+
+  uint32_t a = 0;
+  uint32_t x = 0;
+  uint32_t memory[BPF_MEMWORDS] = {0};
+
+  for (size_t pc = 0; pc < program.size(); pc++) {
+    const struct sock_filter& insn = program[pc];
+    uint32_t operand = BPF_SRC(insn.code) == BPF_X ? x : insn.k;
+
+    switch (BPF_CLASS(insn.code)) {
+      case BPF_LD:
+        switch (BPF_MODE(insn.code)) {
+          case BPF_ABS:
+            if (!loadBytes(packet, length, insn.k, loadSize(insn.code), a)) return 0;
+            break;
+          case BPF_IND:
+            if (!loadBytes(packet, length, static_cast<uint64_t>(x) + insn.k, loadSize(insn.code), a)) return 0;
+            break;
+          case BPF_LEN: a = static_cast<uint32_t>(length); break;
+          case BPF_IMM: a = insn.k; break;
+          case BPF_MEM: a = memory[insn.k % BPF_MEMWORDS]; break;
+          default: return 0;
+        }
+        break;
+
+      case BPF_LDX:
+        switch (BPF_MODE(insn.code)) {
+          case BPF_MSH: {
+            uint32_t byte = 0;
+            if (!loadBytes(packet, length, insn.k, 1, byte)) return 0;
+            x = (byte & 0xf) << 2;
+            break;
+          }
+          case BPF_LEN: x = static_cast<uint32_t>(length); break;
+          case BPF_IMM: x = insn.k; break;
+          case BPF_MEM: x = memory[insn.k % BPF_MEMWORDS]; break;
+          default: return 0;
+        }
+        break;
+
+      case BPF_ST: memory[insn.k % BPF_MEMWORDS] = a; break;
+      case BPF_STX: memory[insn.k % BPF_MEMWORDS] = x; break;
+
+      case BPF_ALU:
+        switch (BPF_OP(insn.code)) {
+          case BPF_ADD: a += operand; break;
+          case BPF_SUB: a -= operand; break;
+          case BPF_MUL: a *= operand; break;
+          case BPF_DIV:
+            if (operand == 0) return 0;
+            a /= operand;
+            break;
+          case BPF_MOD:
+            if (operand == 0) return 0;
+            a %= operand;
+            break;
+          case BPF_AND: a &= operand; break;
+          case BPF_OR: a |= operand; break;
+          case BPF_XOR: a ^= operand; break;
+          case BPF_LSH: a = operand < 32 ? a << operand : 0; break;
+          case BPF_RSH: a = operand < 32 ? a >> operand : 0; break;
+          case BPF_NEG: a = 0 - a; break;
+          default: return 0;
+        }
+        break;
+
+      case BPF_JMP: {
+        if (BPF_OP(insn.code) == BPF_JA) {
+          pc += insn.k;
+          break;
+        }
+        bool taken = false;
+        switch (BPF_OP(insn.code)) {
+          case BPF_JEQ: taken = a == operand; break;
+          case BPF_JGT: taken = a > operand; break;
+          case BPF_JGE: taken = a >= operand; break;
+          case BPF_JSET: taken = (a & operand) != 0; break;
+          default: return 0;
+        }
+        pc += taken ? insn.jt : insn.jf;
+        break;
+      }
+
+      case BPF_RET: return BPF_RVAL(insn.code) == BPF_A ? a : insn.k;
+
+      case BPF_MISC:
+        if (BPF_MISCOP(insn.code) == BPF_TAX) {
+          x = a;
+        } else {
+          a = x;
+        }
+        break;
+
+      default: return 0;
+    }
+  }
+
+  return 0;
+}
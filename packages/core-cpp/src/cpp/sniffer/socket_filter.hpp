@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <linux/filter.h>
+#include <vector>
+
+// Runs a classic BPF socket filter in user space, for capture paths the kernel cannot attach it to (AF_XDP).
+// Returns the number of bytes to keep, 0 to drop the frame; an empty program keeps everything.
+uint32_t runSocketFilter(const std::vector<struct sock_filter>& program, const uint8_t* packet, size_t length);
@@ -0,0 +1,148 @@
+#include "./thread_schedule.hpp"
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <pthread.h>
+#include <sched.h>
+#include <sstream>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+const char* policyName(int policy) {
+  switch (policy) {
+  case SCHED_OTHER:
+    return "other";
+  case SCHED_FIFO:
+    return "fifo";
+  case SCHED_RR:
+    return "rr";
+  case SCHED_BATCH:
+    return "batch";
+  case SCHED_IDLE:
+    return "idle";
+  default:
+    return "unknown";
+  }
+}
+
+} // namespace
+
+std::string validateThreadSchedule(const ThreadSchedule& schedule) {
+  if (!schedule.cpus.empty()) {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) < 0) {
+      return "Failed to read process CPU affinity: " + std::string(strerror(errno));
+    }
+
+    for (int cpu : schedule.cpus) {
+      if (cpu < 0 || cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &allowed)) {
+        return "CPU " + std::to_string(cpu) + " is not available to this process";
+      }
+    }
+  }
+
+  if (schedule.fifo_priority != 0) {
+    int min_priority = sched_get_priority_min(SCHED_FIFO);
+    int max_priority = sched_get_priority_max(SCHED_FIFO);
+    if (schedule.fifo_priority < min_priority || schedule.fifo_priority > max_priority) {
+      return "SCHED_FIFO priority must be between " + std::to_string(min_priority) + " and " +
+             std::to_string(max_priority);
+    }
+  }
+
+  if (schedule.nice.has_value() && (*schedule.nice < -20 || *schedule.nice > 19)) {
+    return "Nice value must be between -20 and 19";
+  }
+
+  return "";
+}
+
+std::string applyThreadSchedule(const ThreadSchedule& schedule) {
+  std::string errors;
+  auto fail = [&errors](const std::string& what) {
+    if (!errors.empty()) {
+      errors += "; ";
+    }
+    errors += what + ": " + strerror(errno);
+  };
+
+  if (!schedule.cpus.empty()) {
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    for (int cpu : schedule.cpus) {
+      CPU_SET(cpu, &mask);
+    }
+    // pid 0 is the calling thread, not the whole process
+    if (sched_setaffinity(0, sizeof(mask), &mask) < 0) {
+      fail("Failed to set CPU affinity");
+    }
+  }
+
+  // Linux keeps the nice value per thread, setpriority on a thread id only affects that thread
+  if (schedule.nice.has_value() && setpriority(PRIO_PROCESS, currentThreadId(), *schedule.nice) < 0) {
+    fail("Failed to set nice value");
+  }
+
+  if (schedule.fifo_priority != 0) {
+    sched_param param{};
+    param.sched_priority = schedule.fifo_priority;
+    int result = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (result != 0) {
+      errno = result;
+      fail("Failed to set SCHED_FIFO");
+    }
+  }
+
+  return errors;
+}
+
+pid_t currentThreadId() {
+  return static_cast<pid_t>(syscall(SYS_gettid));
+}
+
+bool readThreadPlacement(pid_t tid, ThreadPlacement& placement) {
+  std::ifstream stat_file("/proc/self/task/" + std::to_string(tid) + "/stat");
+  std::string line;
+  if (!stat_file || !std::getline(stat_file, line)) {
+    return false;
+  }
+
+  // The command name may contain spaces, the numeric fields start after its closing parenthesis
+  size_t name_end = line.rfind(')');
+  if (name_end == std::string::npos) {
+    return false;
+  }
+  std::istringstream stream(line.substr(name_end + 1));
+  std::vector<std::string> fields{std::istream_iterator<std::string>(stream), std::istream_iterator<std::string>()};
+
+  // fields[0] is field 3 (state) of proc(5): nice is 19, processor 39, rt_priority 40, policy 41
+  if (fields.size() < 39) {
+    return false;
+  }
+
+  cpu_set_t mask;
+  CPU_ZERO(&mask);
+  if (sched_getaffinity(tid, sizeof(mask), &mask) < 0) {
+    return false;
+  }
+
+  placement.tid = tid;
+  placement.nice = std::stoi(fields[16]);
+  placement.cpu = std::stoi(fields[36]);
+  placement.priority = std::stoi(fields[37]);
+  placement.policy = policyName(std::stoi(fields[38]));
+
+  placement.allowed_cpus.clear();
+  for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+    if (CPU_ISSET(cpu, &mask)) {
+      placement.allowed_cpus.push_back(cpu);
+    }
+  }
+
+  return true;
+}
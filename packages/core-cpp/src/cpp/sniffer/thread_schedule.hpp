@@ -0,0 +1,29 @@
+#pragma once
+
+#include "../utils/stats/capture_stats.hpp"
+#include <optional>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+// Requested placement for one class of sniffer threads (all capture threads, or all processing threads)
+struct ThreadSchedule {
+  std::vector<int> cpus;   // Affinity mask, empty keeps the one inherited from the process
+  int fifo_priority = 0;   // 1..99 switches to SCHED_FIFO, 0 keeps the default time-sharing policy
+  std::optional<int> nice; // -20..19, only meaningful without SCHED_FIFO
+
+  bool isDefault() const { return cpus.empty() && fifo_priority == 0 && !nice.has_value(); }
+};
+
+// Checks ranges and that every CPU is usable by this process; returns an error message, empty when valid
+std::string validateThreadSchedule(const ThreadSchedule& schedule);
+
+// Applies the schedule to the calling thread; returns what could not be applied, empty on success
+std::string applyThreadSchedule(const ThreadSchedule& schedule);
+
+// Kernel id of the calling thread, for readThreadPlacement from other threads
+pid_t currentThreadId();
+
+// Reads a thread's current CPU, affinity, policy and nice value back from the kernel.
+// Returns false once the thread has exited, leaving placement untouched.
+bool readThreadPlacement(pid_t tid, ThreadPlacement& placement);
@@ -0,0 +1,335 @@
+#include "xdp_socket.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/bpf.h>
+#include <linux/if_link.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef SOL_XDP
+#define SOL_XDP 283
+#endif
+
+namespace {
+
+long bpf(int command, union bpf_attr& attr) {
+  return syscall(SYS_bpf, command, &attr, sizeof(attr));
+}
+
+std::string describe(const char* step) {
+  return std::string(step) + ": " + strerror(errno);
+}
+
+} // namespace
+
+XdpSocket::XdpSocket()
+    : socket_fd_(-1), map_fd_(-1), program_fd_(-1), link_fd_(-1), umem_(nullptr), umem_size_(0), zero_copy_(false),
+      generic_mode_(false) {}
+
+XdpSocket::~XdpSocket() {
+  close();
+}
+
+bool XdpSocket::open(int interface_index, uint32_t queue_id, uint32_t frame_count, bool generic_only,
+                     std::string& error) {
+  if (frame_count == 0 || (frame_count & (frame_count - 1)) != 0) {
+    error = "XDP frame count must be a power of two";
+    return false;
+  }
+
+  socket_fd_ = socket(AF_XDP, SOCK_RAW | SOCK_CLOEXEC, 0);
+  if (socket_fd_ < 0) {
+    error = describe("AF_XDP socket");
+    return false;
+  }
+
+  if (!createUmem(frame_count, error) || !mapRings(frame_count, error) ||
+      !bindSocket(interface_index, queue_id, generic_only, error) || !loadProgram(queue_id, error) ||
+      !attachProgram(interface_index, generic_only, error)) {
+    close();
+    return false;
+  }
+
+  return true;
+}
+
+void XdpSocket::close() {
+  // Dropping the link detaches the program from the interface
+  for (int* fd : {&link_fd_, &program_fd_, &map_fd_}) {
+    if (*fd != -1) {
+      ::close(*fd);
+      *fd = -1;
+    }
+  }
+
+  unmapRing(rx_);
+  unmapRing(fill_);
+  unmapRing(completion_);
+
+  if (socket_fd_ != -1) {
+    ::close(socket_fd_);
+    socket_fd_ = -1;
+  }
+
+  if (umem_ != nullptr) {
+    munmap(umem_, umem_size_);
+    umem_ = nullptr;
+    umem_size_ = 0;
+  }
+}
+
+int XdpSocket::getDescriptor() const {
+  return socket_fd_;
+}
+
+bool XdpSocket::isZeroCopy() const {
+  return zero_copy_;
+}
+
+bool XdpSocket::isGenericMode() const {
+  return generic_mode_;
+}
+
+size_t XdpSocket::receive(const FrameHandler& handler) {
+  uint32_t consumer = *rx_.consumer;
+  uint32_t available = __atomic_load_n(rx_.producer, __ATOMIC_ACQUIRE) - consumer;
+  available = std::min<uint32_t>(available, CAPTURE_BATCH_SIZE);
+  if (available == 0) {
+    return 0;
+  }
+
+  // Every frame is either in the fill ring, owned by the kernel or in the RX ring, so there is
+  // always room to hand back what was just received
+  auto* descriptors = static_cast<struct xdp_desc*>(rx_.descriptors);
+  auto* fill_addresses = static_cast<uint64_t*>(fill_.descriptors);
+  uint32_t fill_producer = *fill_.producer;
+
+  Frame frames[CAPTURE_BATCH_SIZE];
+  for (uint32_t i = 0; i < available; i++) {
+    const struct xdp_desc& descriptor = descriptors[(consumer + i) & (rx_.size - 1)];
+    frames[i] = Frame{umem_ + descriptor.addr, descriptor.len};
+    fill_addresses[(fill_producer + i) & (fill_.size - 1)] = descriptor.addr & ~static_cast<uint64_t>(XDP_FRAME_SIZE - 1);
+  }
+
+  // The kernel only reuses the frames once the fill producer below moves
+  if (handler) {
+    handler(frames, available);
+  }
+
+  __atomic_store_n(rx_.consumer, consumer + available, __ATOMIC_RELEASE);
+  __atomic_store_n(fill_.producer, fill_producer + available, __ATOMIC_RELEASE);
+
+  // Bound with XDP_USE_NEED_WAKEUP: a driver that ran out of fill entries only resumes after a syscall
+  if (__atomic_load_n(fill_.flags, __ATOMIC_ACQUIRE) & XDP_RING_NEED_WAKEUP) {
+    recvfrom(socket_fd_, nullptr, 0, MSG_DONTWAIT, nullptr, nullptr);
+  }
+  return available;
+}
+
+bool XdpSocket::readDropCount(uint64_t& dropped) const {
+  struct xdp_statistics stats;
+  std::memset(&stats, 0, sizeof(stats));
+  socklen_t length = sizeof(stats);
+
+  if (socket_fd_ == -1 || getsockopt(socket_fd_, SOL_XDP, XDP_STATISTICS, &stats, &length) < 0) {
+    return false;
+  }
+
+  dropped = stats.rx_dropped + stats.rx_ring_full;
+  return true;
+}
+
+bool XdpSocket::createUmem(uint32_t frame_count, std::string& error) {
+  umem_size_ = static_cast<size_t>(frame_count) * XDP_FRAME_SIZE;
+  void* area = mmap(nullptr, umem_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+  if (area == MAP_FAILED) {
+    umem_size_ = 0;
+    error = describe("UMEM allocation");
+    return false;
+  }
+  umem_ = static_cast<uint8_t*>(area);
+
+  struct xdp_umem_reg registration;
+  std::memset(&registration, 0, sizeof(registration));
+  registration.addr = reinterpret_cast<uint64_t>(umem_);
+  registration.len = umem_size_;
+  registration.chunk_size = XDP_FRAME_SIZE;
+
+  if (setsockopt(socket_fd_, SOL_XDP, XDP_UMEM_REG, &registration, sizeof(registration)) < 0) {
+    error = describe("XDP_UMEM_REG");
+    return false;
+  }
+
+  return true;
+}
+
+bool XdpSocket::mapRings(uint32_t frame_count, std::string& error) {
+  // Capture only: the completion ring is mandatory for the UMEM but never used without TX
+  if (setsockopt(socket_fd_, SOL_XDP, XDP_UMEM_FILL_RING, &frame_count, sizeof(frame_count)) < 0 ||
+      setsockopt(socket_fd_, SOL_XDP, XDP_UMEM_COMPLETION_RING, &frame_count, sizeof(frame_count)) < 0 ||
+      setsockopt(socket_fd_, SOL_XDP, XDP_RX_RING, &frame_count, sizeof(frame_count)) < 0) {
+    error = describe("XDP ring sizes");
+    return false;
+  }
+
+  struct xdp_mmap_offsets offsets;
+  socklen_t length = sizeof(offsets);
+  if (getsockopt(socket_fd_, SOL_XDP, XDP_MMAP_OFFSETS, &offsets, &length) < 0) {
+    error = describe("XDP_MMAP_OFFSETS");
+    return false;
+  }
+
+  if (!mapRing(rx_, XDP_PGOFF_RX_RING, offsets.rx, frame_count, sizeof(struct xdp_desc), error) ||
+      !mapRing(fill_, XDP_UMEM_PGOFF_FILL_RING, offsets.fr, frame_count, sizeof(uint64_t), error) ||
+      !mapRing(completion_, XDP_UMEM_PGOFF_COMPLETION_RING, offsets.cr, frame_count, sizeof(uint64_t), error)) {
+    return false;
+  }
+
+  // Hand the whole UMEM to the kernel before the socket is bound
+  auto* fill_addresses = static_cast<uint64_t*>(fill_.descriptors);
+  for (uint32_t i = 0; i < frame_count; i++) {
+    fill_addresses[i] = static_cast<uint64_t>(i) * XDP_FRAME_SIZE;
+  }
+  __atomic_store_n(fill_.producer, frame_count, __ATOMIC_RELEASE);
+
+  return true;
+}
+
+bool XdpSocket::mapRing(Ring& ring, off_t page_offset, const struct xdp_ring_offset& offsets, uint32_t size,
+                        size_t descriptor_size, std::string& error) {
+  size_t map_size = offsets.desc + size * descriptor_size;
+  void* map = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, socket_fd_, page_offset);
+  if (map == MAP_FAILED) {
+    error = describe("XDP ring mmap");
+    return false;
+  }
+
+  auto* base = static_cast<uint8_t*>(map);
+  ring.map = map;
+  ring.map_size = map_size;
+  ring.size = size;
+  ring.producer = reinterpret_cast<uint32_t*>(base + offsets.producer);
+  ring.consumer = reinterpret_cast<uint32_t*>(base + offsets.consumer);
+  ring.flags = reinterpret_cast<uint32_t*>(base + offsets.flags);
+  ring.descriptors = base + offsets.desc;
+  return true;
+}
+
+void XdpSocket::unmapRing(Ring& ring) {
+  if (ring.map != nullptr) {
+    munmap(ring.map, ring.map_size);
+  }
+  ring = Ring();
+}
+
+bool XdpSocket::bindSocket(int interface_index, uint32_t queue_id, bool generic_only, std::string& error) {
+  struct sockaddr_xdp address;
+  std::memset(&address, 0, sizeof(address));
+  address.sxdp_family = AF_XDP;
+  address.sxdp_ifindex = static_cast<uint32_t>(interface_index);
+  address.sxdp_queue_id = queue_id;
+
+  // Zero-copy needs driver support (most virtual devices only do copy mode) and the native hook
+  address.sxdp_flags = XDP_ZEROCOPY | XDP_USE_NEED_WAKEUP;
+  if (!generic_only && bind(socket_fd_, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) == 0) {
+    zero_copy_ = true;
+    return true;
+  }
+
+  address.sxdp_flags = XDP_COPY | XDP_USE_NEED_WAKEUP;
+  if (bind(socket_fd_, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) == 0) {
+    zero_copy_ = false;
+    return true;
+  }
+
+  error = describe("AF_XDP bind");
+  return false;
+}
+
+bool XdpSocket::loadProgram(uint32_t queue_id, std::string& error) {
+  union bpf_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.map_type = BPF_MAP_TYPE_XSKMAP;
+  attr.key_size = sizeof(uint32_t);
+  attr.value_size = sizeof(uint32_t);
+  attr.max_entries = queue_id + 1;
+
+  map_fd_ = static_cast<int>(bpf(BPF_MAP_CREATE, attr));
+  if (map_fd_ < 0) {
+    error = describe("XSKMAP creation");
+    return false;
+  }
+
+  uint32_t key = queue_id;
+  uint32_t value = static_cast<uint32_t>(socket_fd_);
+  std::memset(&attr, 0, sizeof(attr));
+  attr.map_fd = static_cast<uint32_t>(map_fd_);
+  attr.key = reinterpret_cast<uint64_t>(&key);
+  attr.value = reinterpret_cast<uint64_t>(&value);
+  if (bpf(BPF_MAP_UPDATE_ELEM, attr) < 0) {
+    error = describe("XSKMAP update");
+    return false;
+  }
+
+  // return bpf_redirect_map(&xskmap, ctx->rx_queue_index, XDP_PASS);
+  // Queues without a socket in the map fall through to the regular stack, the bound queue does not
+  struct bpf_insn program[] = {
+      {BPF_LDX | BPF_MEM | BPF_W, BPF_REG_2, BPF_REG_1, offsetof(struct xdp_md, rx_queue_index), 0},
+      {BPF_LD | BPF_DW | BPF_IMM, BPF_REG_1, BPF_PSEUDO_MAP_FD, 0, map_fd_},
+      {0, 0, 0, 0, 0},
+      {BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_3, 0, 0, XDP_PASS},
+      {BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_redirect_map},
+      {BPF_JMP | BPF_EXIT, 0, 0, 0, 0},
+  };
+  static const char license[] = "MIT";
+  char log[1024] = {0};
+
+  std::memset(&attr, 0, sizeof(attr));
+  attr.prog_type = BPF_PROG_TYPE_XDP;
+  attr.insns = reinterpret_cast<uint64_t>(program);
+  attr.insn_cnt = sizeof(program) / sizeof(program[0]);
+  attr.license = reinterpret_cast<uint64_t>(license);
+  attr.log_buf = reinterpret_cast<uint64_t>(log);
+  attr.log_size = sizeof(log);
+  attr.log_level = 1;
+
+  program_fd_ = static_cast<int>(bpf(BPF_PROG_LOAD, attr));
+  if (program_fd_ < 0) {
+    error = describe("XDP program load");
+    if (log[0] != '\0') {
+      error += " (" + std::string(log) + ")";
+    }
+    return false;
+  }
+
+  return true;
+}
+
+bool XdpSocket::attachProgram(int interface_index, bool generic_only, std::string& error) {
+  // A zero-copy socket only receives from the driver hook, copy mode can use the generic one
+  uint32_t modes[] = {XDP_FLAGS_DRV_MODE, XDP_FLAGS_SKB_MODE};
+  size_t first_mode = generic_only ? 1 : 0;
+  size_t mode_count = zero_copy_ ? 1 : 2;
+
+  for (size_t i = first_mode; i < mode_count; i++) {
+    union bpf_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.link_create.prog_fd = static_cast<uint32_t>(program_fd_);
+    attr.link_create.target_ifindex = static_cast<uint32_t>(interface_index);
+    attr.link_create.attach_type = BPF_XDP;
+    attr.link_create.flags = modes[i];
+
+    link_fd_ = static_cast<int>(bpf(BPF_LINK_CREATE, attr));
+    if (link_fd_ >= 0) {
+      generic_mode_ = modes[i] == XDP_FLAGS_SKB_MODE;
+      return true;
+    }
+  }
+
+  error = describe("XDP attach");
+  return false;
+}
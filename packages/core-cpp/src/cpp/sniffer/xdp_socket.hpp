@@ -0,0 +1,78 @@
+#pragma once
+
+#include "../utils/common/common.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <linux/if_xdp.h>
+#include <string>
+
+// AF_XDP socket bound to one RX queue, with its UMEM and a minimal XDP program that redirects
+// that queue into it. Frames are read in place from the UMEM shared with the kernel. Redirected frames are
+// consumed: nothing on that queue reaches the kernel stack until the program is detached by close().
+class XdpSocket {
+public:
+  struct Frame {
+    const uint8_t* data;
+    uint32_t length;
+  };
+  using FrameHandler = std::function<void(const Frame* frames, size_t count)>;
+
+  XdpSocket();
+  ~XdpSocket();
+
+  XdpSocket(const XdpSocket&) = delete;
+  XdpSocket& operator=(const XdpSocket&) = delete;
+
+  // Tries zero-copy with the native driver hook first, then copy mode with generic (skb) XDP; generic_only
+  // goes straight to the latter
+  bool open(int interface_index, uint32_t queue_id, uint32_t frame_count, bool generic_only, std::string& error);
+  void close();
+
+  int getDescriptor() const;
+  bool isZeroCopy() const;
+  bool isGenericMode() const;
+
+  // Hands up to CAPTURE_BATCH_SIZE frames waiting in the RX ring to handler in one call, then recycles
+  // them to the fill ring. Frame data is only valid during the handler call. Returns the number of frames.
+  size_t receive(const FrameHandler& handler);
+
+  // XDP_STATISTICS, cumulative: frames lost for lack of RX ring space or fill ring entries
+  bool readDropCount(uint64_t& dropped) const;
+
+private:
+  // Single-producer/single-consumer ring shared with the kernel through mmap
+  struct Ring {
+    uint32_t* producer = nullptr;
+    uint32_t* consumer = nullptr;
+    uint32_t* flags = nullptr;
+    void* descriptors = nullptr;
+    uint32_t size = 0;
+    void* map = nullptr;
+    size_t map_size = 0;
+  };
+
+  int socket_fd_;
+  int map_fd_;
+  int program_fd_;
+  int link_fd_;
+
+  uint8_t* umem_;
+  size_t umem_size_;
+
+  Ring rx_;
+  Ring fill_;
+  Ring completion_;
+
+  bool zero_copy_;
+  bool generic_mode_;
+
+  bool createUmem(uint32_t frame_count, std::string& error);
+  bool mapRings(uint32_t frame_count, std::string& error);
+  bool mapRing(Ring& ring, off_t page_offset, const struct xdp_ring_offset& offsets, uint32_t size,
+               size_t descriptor_size, std::string& error);
+  void unmapRing(Ring& ring);
+  bool bindSocket(int interface_index, uint32_t queue_id, bool generic_only, std::string& error);
+  bool loadProgram(uint32_t queue_id, std::string& error);
+  bool attachProgram(int interface_index, bool generic_only, std::string& error);
+};
@@ -0,0 +1,151 @@
+#include "packet_pool.hpp"
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+PacketBuffer::PacketBuffer(PacketPool* pool, uint32_t size_class, uint32_t capacity)
+    : size_class_(size_class), capacity_(capacity), pool_(pool) {}
+
+PacketView PacketBuffer::view() const {
+  PacketView result;
+  result.data = data();
+  result.length = length;
+  result.original_length = original_length;
+  result.interface_index = interface_index;
+  result.timestamp = timestamp;
+  result.buffer = const_cast<PacketBuffer*>(this);
+  return result;
+}
+
+void PacketBuffer::release() {
+  if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    pool_->recycle(this);
+  }
+}
+
+PacketRef::PacketRef(PacketBuffer* buffer) : buffer_(buffer) {}
+
+PacketRef::PacketRef(const PacketRef& other) : buffer_(other.buffer_) {
+  if (buffer_ != nullptr) {
+    buffer_->addRef();
+  }
+}
+
+PacketRef::PacketRef(PacketRef&& other) noexcept : buffer_(other.buffer_) {
+  other.buffer_ = nullptr;
+}
+
+PacketRef& PacketRef::operator=(PacketRef other) noexcept {
+  std::swap(buffer_, other.buffer_);
+  return *this;
+}
+
+PacketRef::~PacketRef() {
+  reset();
+}
+
+void PacketRef::reset() {
+  if (buffer_ != nullptr) {
+    buffer_->release();
+    buffer_ = nullptr;
+  }
+}
+
+PacketView PacketRef::view() const {
+  return buffer_ != nullptr ? buffer_->view() : PacketView();
+}
+
+PacketPool& PacketPool::shared() {
+  static PacketPool* pool = new PacketPool();
+  return *pool;
+}
+
+PacketPool::PacketPool() {
+  for (size_t i = 0; i < classes_.size(); i++) {
+    classes_[i].capacity = PACKET_POOL_SIZE_CLASSES[i];
+    size_t alignment = alignof(PacketBuffer);
+    classes_[i].stride = (sizeof(PacketBuffer) + classes_[i].capacity + alignment - 1) & ~(alignment - 1);
+  }
+}
+
+PacketRef PacketPool::acquire(size_t length) {
+  length = std::min(length, MAX_PACKET_SIZE);
+
+  uint32_t size_class = 0;
+  while (classes_[size_class].capacity < length) {
+    size_class++;
+  }
+
+  SizeClass& pool_class = classes_[size_class];
+  PacketBuffer* buffer = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(pool_class.mutex);
+    if (pool_class.free == nullptr) {
+      grow(size_class);
+    }
+    buffer = pool_class.free;
+    pool_class.free = buffer->next_free_;
+  }
+  in_use_.fetch_add(1, std::memory_order_relaxed);
+
+  buffer->next_free_ = nullptr;
+  buffer->refs_.store(1, std::memory_order_relaxed);
+  buffer->length = length;
+  buffer->original_length = length;
+  buffer->interface_index = -1;
+  buffer->timestamp = PacketTimestamp();
+  return PacketRef(buffer);
+}
+
+PacketRef PacketPool::share(const PacketView& packet) {
+  if (packet.buffer != nullptr) {
+    packet.buffer->addRef();
+    return PacketRef(packet.buffer);
+  }
+
+  size_t length = packet.data != nullptr ? std::min(packet.length, MAX_PACKET_SIZE) : 0;
+  PacketRef copy = acquire(length);
+  if (length > 0) {
+    std::memcpy(copy->data(), packet.data, length);
+  }
+  copy->original_length = packet.original_length;
+  copy->interface_index = packet.interface_index;
+  copy->timestamp = packet.timestamp;
+  return copy;
+}
+
+size_t PacketPool::getSlabCount() const {
+  size_t count = 0;
+  for (const SizeClass& pool_class : classes_) {
+    std::lock_guard<std::mutex> lock(pool_class.mutex);
+    count += pool_class.slabs.size();
+  }
+  return count;
+}
+
+size_t PacketPool::getBuffersInUse() const {
+  return in_use_.load(std::memory_order_relaxed);
+}
+
+void PacketPool::grow(uint32_t size_class) {
+  SizeClass& pool_class = classes_[size_class];
+  size_t count = std::max<size_t>(PACKET_POOL_SLAB_BYTES / pool_class.stride, 1);
+
+  auto slab = std::make_unique<uint8_t[]>(count * pool_class.stride);
+  for (size_t i = count; i-- > 0;) {
+    auto* buffer = new (slab.get() + i * pool_class.stride) PacketBuffer(this, size_class, pool_class.capacity);
+    buffer->next_free_ = pool_class.free;
+    pool_class.free = buffer;
+  }
+  pool_class.slabs.push_back(std::move(slab));
+}
+
+void PacketPool::recycle(PacketBuffer* buffer) {
+  SizeClass& pool_class = classes_[buffer->size_class_];
+  {
+    std::lock_guard<std::mutex> lock(pool_class.mutex);
+    buffer->next_free_ = pool_class.free;
+    pool_class.free = buffer;
+  }
+  in_use_.fetch_sub(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "../common/common.hpp"
+#include "../packets/packet_model.hpp"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <napi.h>
+#include <vector>
+
+class PacketPool;
+
+// Packet bytes in a pooled buffer, for stages that keep a packet after its ring record is released (merger,
+// N-API callback, JS ArrayBuffer). Intrusively reference counted, it returns to its pool's freelist when the
+// last reference drops. The bytes follow the header in the same slab allocation.
+class PacketBuffer {
+public:
+  PacketBuffer(const PacketBuffer&) = delete;
+  PacketBuffer& operator=(const PacketBuffer&) = delete;
+
+  uint8_t* data() { return reinterpret_cast<uint8_t*>(this + 1); }
+  const uint8_t* data() const { return reinterpret_cast<const uint8_t*>(this + 1); }
+  size_t capacity() const { return capacity_; }
+  // Borrowed view of the bytes; it names this buffer so a consumer can add a reference instead of copying
+  PacketView view() const;
+
+  void addRef() { refs_.fetch_add(1, std::memory_order_relaxed); }
+  void release();
+
+  size_t length = 0;
+  size_t original_length = 0;
+  int interface_index = -1;
+  PacketTimestamp timestamp;
+
+private:
+  friend class PacketPool;
+  PacketBuffer(PacketPool* pool, uint32_t size_class, uint32_t capacity);
+
+  std::atomic<uint32_t> refs_{0};
+  uint32_t size_class_;
+  uint32_t capacity_;
+  PacketPool* pool_;
+  PacketBuffer* next_free_ = nullptr;
+};
+
+// Owning handle on a PacketBuffer, copying it adds a reference
+class PacketRef {
+public:
+  PacketRef() = default;
+  PacketRef(const PacketRef& other);
+  PacketRef(PacketRef&& other) noexcept;
+  PacketRef& operator=(PacketRef other) noexcept;
+  ~PacketRef();
+
+  PacketBuffer* get() const { return buffer_; }
+  PacketBuffer* operator->() const { return buffer_; }
+  explicit operator bool() const { return buffer_ != nullptr; }
+  // Empty view (null data) when the handle is empty
+  PacketView view() const;
+  void reset();
+
+  // Same shape as RawPacket::toNapiObject. The ArrayBuffer wraps the pooled bytes and holds a reference until
+  // JS collects it; runtimes that refuse external buffers (Electron's V8 sandbox) get a copy instead.
+  Napi::Object toNapiObject(Napi::Env& env) const;
+
+private:
+  friend class PacketPool;
+  explicit PacketRef(PacketBuffer* buffer); // Adopts a reference already taken
+
+  PacketBuffer* buffer_ = nullptr;
+};
+
+// Fixed-size packet buffers carved from slabs, one freelist per size class. A class grows by a slab when its
+// freelist runs dry and keeps it, so once the high-water mark is reached acquiring and releasing never
+// allocates. Thread-safe: buffers are usually taken on a processing thread and released on the JS thread.
+class PacketPool {
+public:
+  // Process-wide pool; never destroyed, since JS may collect the last ArrayBuffer during shutdown
+  static PacketPool& shared();
+
+  PacketPool();
+
+  PacketPool(const PacketPool&) = delete;
+  PacketPool& operator=(const PacketPool&) = delete;
+
+  // Buffer of the smallest size class holding length bytes (at most MAX_PACKET_SIZE), with length set
+  PacketRef acquire(size_t length);
+  // The view's own buffer when it has one, otherwise a pooled copy of its bytes and metadata
+  PacketRef share(const PacketView& packet);
+
+  size_t getSlabCount() const;
+  size_t getBuffersInUse() const;
+
+private:
+  friend class PacketBuffer;
+
+  struct SizeClass {
+    uint32_t capacity = 0;
+    size_t stride = 0; // Header and capacity, rounded to the header's alignment
+    mutable std::mutex mutex;
+    PacketBuffer* free = nullptr;
+    std::vector<std::unique_ptr<uint8_t[]>> slabs;
+  };
+  std::array<SizeClass, PACKET_POOL_SIZE_CLASSES.size()> classes_;
+  std::atomic<size_t> in_use_{0};
+
+  // Carves one more slab into the class's freelist, caller holds the class's mutex
+  void grow(uint32_t size_class);
+  void recycle(PacketBuffer* buffer);
+};
@@ -0,0 +1,42 @@
+#include "packet_pool.hpp"
+#include <cstring>
+
+Napi::Object PacketRef::toNapiObject(Napi::Env& env) const {
+  Napi::Object obj = Napi::Object::New(env);
+  size_t length = buffer_ != nullptr ? buffer_->length : 0;
+
+  if (length > 0) {
+    napi_value array_buffer = nullptr;
+    buffer_->addRef();
+    napi_status status = napi_create_external_arraybuffer(
+        env, buffer_->data(), length,
+        [](napi_env, void*, void* hint) { static_cast<PacketBuffer*>(hint)->release(); }, buffer_, &array_buffer);
+
+    Napi::ArrayBuffer buffer;
+    if (status == napi_ok) {
+      buffer = Napi::ArrayBuffer(env, array_buffer);
+    } else {
+      // No finalizer will run for a buffer that was not created
+      buffer_->release();
+      buffer = Napi::ArrayBuffer::New(env, length);
+      std::memcpy(buffer.Data(), buffer_->data(), length);
+    }
+    obj.Set("data", Napi::Uint8Array::New(env, length, buffer, 0));
+  } else {
+    obj.Set("data", Napi::Uint8Array::New(env, 0));
+  }
+
+  PacketView packet = view();
+  obj.Set("length", Napi::Number::New(env, static_cast<double>(length)));
+  obj.Set("originalLength", Napi::Number::New(env, static_cast<double>(packet.original_length)));
+  obj.Set("interfaceIndex", Napi::Number::New(env, packet.interface_index));
+
+  auto epoch = packet.timestamp.time_since_epoch();
+  auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(epoch).count();
+  obj.Set("timestamp", Napi::Number::New(env, static_cast<double>(millis)));
+  obj.Set("timestampNs", Napi::BigInt::New(env, static_cast<int64_t>(epoch.count())));
+
+  obj.Set("valid", Napi::Boolean::New(env, buffer_ != nullptr));
+
+  return obj;
+}
@@ -1,48 +1,456 @@
 #include "ring_buffer.hpp"
+#include <algorithm>
+#include <linux/futex.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
 
-RingBuffer::RingBuffer() : write_index_(0), read_index_(0) {}
+namespace {
+
+size_t roundCapacity(size_t capacity_bytes) {
+  capacity_bytes = std::clamp(capacity_bytes, RING_BUFFER_MIN_BYTES, RING_BUFFER_MAX_BYTES);
+  size_t capacity = RING_BUFFER_MIN_BYTES;
+  while (capacity < capacity_bytes) {
+    capacity <<= 1;
+  }
+  return capacity;
+}
+
+void signalEventFd(int fd) {
+  uint64_t value = 1;
+  ssize_t bytes = write(fd, &value, sizeof(value));
+  (void)bytes;
+}
+
+// Tells the core we are in a spin loop, so a sibling hyperthread gets the pipeline meanwhile
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex word must be a plain 32-bit integer");
+
+// Sleeps while word still holds expected; returns early on a wake, a signal, or a changed word
+void futexWait(std::atomic<uint32_t>& word, uint32_t expected) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+}
+
+void futexWake(std::atomic<uint32_t>& word) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+}
+
+} // namespace
+
+RingBuffer::RingBuffer(size_t capacity_bytes, OverflowPolicy policy, std::chrono::milliseconds block_timeout,
+                       WaitStrategy wait_strategy)
+    : capacity_(roundCapacity(capacity_bytes)), mask_(capacity_ - 1), policy_(policy), block_timeout_(block_timeout),
+      wait_strategy_(wait_strategy), space_fd_(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) {
+  buffer_ = std::make_unique<uint8_t[]>(capacity_);
+}
+
+RingBuffer::~RingBuffer() {
+  if (space_fd_ != -1) {
+    close(space_fd_);
+  }
+}
+
+size_t RingBuffer::recordSize(size_t length) const {
+  return (sizeof(RecordHeader) + length + RECORD_ALIGNMENT - 1) & ~(RECORD_ALIGNMENT - 1);
+}
+
+size_t RingBuffer::pushBatch(const PacketView* packets, size_t count) {
+  uint64_t write_position = producer_.write_position.load(std::memory_order_relaxed);
+  uint64_t published_position = write_position;
+  size_t kept = 0;
+
+  for (size_t i = 0; i < count; i++) {
+    if (appendRecord(packets[i], write_position, published_position)) {
+      kept++;
+    }
+  }
+
+  if (write_position != published_position) {
+    publish(write_position);
+  }
+  return kept;
+}
+
+bool RingBuffer::push(const PacketView& packet) {
+  return pushBatch(&packet, 1) == 1;
+}
 
 bool RingBuffer::push(const RawPacket& packet) {
-  if (packet.length > MAX_PACKET_SIZE) return false;
+  PacketView view;
+  view.data = packet.data.data();
+  view.length = packet.length;
+  view.original_length = packet.original_length;
+  view.interface_index = packet.interface_index;
+  view.timestamp = packet.timestamp;
+  return push(view);
+}
+
+bool RingBuffer::appendRecord(const PacketView& packet, uint64_t& write_position, uint64_t& published_position) {
+  size_t copy_length = std::min(packet.length, MAX_PACKET_SIZE);
+  size_t record_size = recordSize(copy_length);
+
+  // A record never straddles the end of the buffer, the tail is skipped when it is too short
+  size_t offset = write_position & mask_;
+  size_t tail = capacity_ - offset;
+  size_t needed = record_size <= tail ? record_size : tail + record_size;
 
-  size_t current_write = write_index_.load(std::memory_order_relaxed);
-  size_t next_write = (current_write + 1) % RING_SIZE;
-  size_t current_read = read_index_.load(std::memory_order_acquire);
+  if (freeSpace(write_position, needed) < needed) {
+    // The consumer can only free space, or be evicted from, up to what it has been shown
+    if (write_position != published_position) {
+      publish(write_position);
+      published_position = write_position;
+    }
 
-  if (next_write == current_read) {
-    read_index_.store((current_read + 1) % RING_SIZE, std::memory_order_release);
+    switch (policy_) {
+    case OverflowPolicy::DropNewest:
+      producer_.dropped_newest.increment();
+      return false;
+    case OverflowPolicy::DropOldest:
+      // Only records the consumer has claimed can stand in the way. It holds them until releaseBatch(), after
+      // parsing and delivering them, which can take as long as the merger's back-pressure: wait no longer than
+      // Block would, then drop the incoming packet instead.
+      if (!makeSpace(write_position, needed) && !waitForSpace(write_position, needed)) {
+        producer_.dropped_newest.increment();
+        return false;
+      }
+      break;
+    case OverflowPolicy::Block:
+      if (!waitForSpace(write_position, needed)) {
+        producer_.block_timeouts.increment();
+        return false;
+      }
+      break;
+    }
   }
 
-  buffer_[current_write] = packet;
-  write_index_.store(next_write, std::memory_order_release);
+  if (record_size > tail) {
+    // Offsets are RECORD_ALIGNMENT-aligned, so the tail always has room for the marker
+    uint32_t wrap_marker = 0;
+    std::memcpy(buffer_.get() + offset, &wrap_marker, sizeof(wrap_marker));
+    write_position += tail;
+    offset = 0;
+  }
+
+  RecordHeader header{};
+  header.size = static_cast<uint32_t>(record_size);
+  header.length = static_cast<uint32_t>(copy_length);
+  header.original_length = static_cast<uint32_t>(packet.original_length);
+  header.interface_index = packet.interface_index;
+  header.timestamp_ns = packet.timestamp.time_since_epoch().count();
 
-  cv_.notify_one();
+  uint8_t* payload = buffer_.get() + offset + sizeof(header);
+  std::memcpy(buffer_.get() + offset, &header, sizeof(header));
+  // Received straight into the reserved space, nothing left to copy
+  if (packet.data != payload) {
+    std::memcpy(payload, packet.data, copy_length);
+  }
+  write_position += record_size;
   return true;
 }
 
-bool RingBuffer::pop(RawPacket& out) {
-  size_t current_read = read_index_.load(std::memory_order_acquire);
-  size_t current_write = write_index_.load(std::memory_order_acquire);
+uint8_t* RingBuffer::reserve(size_t max_length) {
+  size_t record_size = recordSize(std::min(max_length, MAX_PACKET_SIZE));
+  uint64_t write_position = producer_.write_position.load(std::memory_order_relaxed);
+
+  // Same placement appendRecord() picks for a record of this size
+  size_t offset = write_position & mask_;
+  size_t tail = capacity_ - offset;
+  size_t needed = record_size <= tail ? record_size : tail + record_size;
+
+  if (freeSpace(write_position, needed) < needed) {
+    return nullptr;
+  }
+  return buffer_.get() + (record_size <= tail ? offset : 0) + sizeof(RecordHeader);
+}
+
+void RingBuffer::publish(uint64_t write_position) {
+  producer_.write_position.store(write_position, std::memory_order_release);
+
+  // Spinning consumers watch the position themselves, only a parked one needs a wake-up
+  if (wait_strategy_ != WaitStrategy::SpinPark) {
+    return;
+  }
+
+  // Pairs with the fence in waitForData(): either the consumer sees the new position or we see it waiting.
+  // It only parks after finding the ring empty, so this is the empty to non-empty transition.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (consumer_.waiting.load(std::memory_order_relaxed)) {
+    wakeConsumer();
+  }
+}
+
+size_t RingBuffer::freeSpace(uint64_t write_position, size_t needed) {
+  size_t free_bytes = capacity_ - (write_position - producer_.read_limit_cache);
+  if (free_bytes >= needed) {
+    return free_bytes;
+  }
+
+  // Load order matters under DropOldest: a claim seen through read_position has its reading_position visible
+  uint64_t limit = consumer_.read_position.load(std::memory_order_seq_cst);
+  if (policy_ == OverflowPolicy::DropOldest) {
+    limit = std::min(limit, consumer_.reading_position.load(std::memory_order_seq_cst));
+  }
+  producer_.read_limit_cache = limit;
+  return capacity_ - (write_position - limit);
+}
 
-  if (current_read == current_write) {
+bool RingBuffer::evictOldest(uint64_t write_position) {
+  uint64_t read_position = consumer_.read_position.load(std::memory_order_seq_cst);
+  // Below read_position the limit is the consumer's in-flight copy, evicting further would free nothing
+  if (read_position == write_position || read_position != producer_.read_limit_cache) {
     return false;
   }
 
-  const RawPacket& pkt = buffer_[current_read];
-  if (!pkt.valid) return false;
+  // The producer wrote this header and has not reclaimed it, reading it cannot race
+  size_t offset = read_position & mask_;
+  uint32_t size = 0;
+  std::memcpy(&size, buffer_.get() + offset, sizeof(size));
+  uint64_t next_position = read_position + (size == 0 ? capacity_ - offset : size);
 
-  out = pkt;
-  read_index_.store((current_read + 1) % RING_SIZE, std::memory_order_release);
+  // Fails when the consumer claimed the record first, the caller re-checks the space either way
+  if (consumer_.read_position.compare_exchange_strong(read_position, next_position, std::memory_order_seq_cst) &&
+      size != 0) {
+    producer_.dropped_oldest.increment();
+  }
   return true;
 }
 
-bool RingBuffer::waitForData(std::chrono::milliseconds timeout) {
-  std::unique_lock<std::mutex> lock(mutex_);
-  return cv_.wait_for(lock, timeout, [this] {
-    return read_index_.load(std::memory_order_acquire) != write_index_.load(std::memory_order_acquire);
-  });
+bool RingBuffer::makeSpace(uint64_t write_position, size_t needed) {
+  while (freeSpace(write_position, needed) < needed) {
+    if (policy_ != OverflowPolicy::DropOldest || !evictOldest(write_position)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool RingBuffer::waitForSpace(uint64_t write_position, size_t needed) {
+  auto deadline = std::chrono::steady_clock::now() + block_timeout_;
+
+  while (true) {
+    // Pairs with the fence in releaseBatch(): either we see the freed space or the consumer sees us waiting
+    producer_.waiting.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (makeSpace(write_position, needed)) {
+      producer_.waiting.store(false, std::memory_order_relaxed);
+      return true;
+    }
+
+    auto remaining = deadline - std::chrono::steady_clock::now();
+    if (remaining <= std::chrono::steady_clock::duration::zero()) {
+      producer_.waiting.store(false, std::memory_order_relaxed);
+      return false;
+    }
+
+    pollfd descriptor{space_fd_, POLLIN, 0};
+    auto remaining_ms = std::chrono::ceil<std::chrono::milliseconds>(remaining);
+    poll(&descriptor, 1, static_cast<int>(remaining_ms.count()));
+
+    uint64_t value = 0;
+    ssize_t bytes = read(space_fd_, &value, sizeof(value));
+    (void)bytes;
+  }
+}
+
+size_t RingBuffer::claimRecords(size_t max_count, uint64_t& first_position, uint64_t& end_position) {
+  while (true) {
+    uint64_t read_position = consumer_.read_position.load(std::memory_order_seq_cst);
+    if (read_position >= consumer_.write_position_cache) {
+      consumer_.write_position_cache = producer_.write_position.load(std::memory_order_acquire);
+      if (read_position == consumer_.write_position_cache) {
+        // A stale announcement would hold back the producer's evictions
+        if (policy_ == OverflowPolicy::DropOldest) {
+          consumer_.reading_position.store(NOT_READING, std::memory_order_seq_cst);
+        }
+        return 0;
+      }
+    }
+
+    if (policy_ == OverflowPolicy::DropOldest) {
+      // Announce the copy before touching the bytes, then make sure nothing was evicted in between
+      consumer_.reading_position.store(read_position, std::memory_order_seq_cst);
+      if (consumer_.read_position.load(std::memory_order_seq_cst) != read_position) {
+        continue;
+      }
+    }
+
+    size_t count = 0;
+    uint64_t position = read_position;
+    while (count < max_count && position != consumer_.write_position_cache) {
+      uint32_t size = 0;
+      uint64_t start = recordStart(position);
+      std::memcpy(&size, buffer_.get() + (start & mask_), sizeof(size));
+      position = start + size;
+      count++;
+    }
+
+    if (policy_ == OverflowPolicy::DropOldest &&
+        !consumer_.read_position.compare_exchange_strong(read_position, position, std::memory_order_seq_cst)) {
+      continue;
+    }
+
+    first_position = read_position;
+    end_position = position;
+    return count;
+  }
+}
+
+uint64_t RingBuffer::recordStart(uint64_t position) const {
+  size_t offset = position & mask_;
+  uint32_t size = 0;
+  std::memcpy(&size, buffer_.get() + offset, sizeof(size));
+  // Wrap marker, the record itself was published together with it at offset 0
+  return size == 0 ? position + (capacity_ - offset) : position;
+}
+
+uint64_t RingBuffer::viewRecord(uint64_t position, PacketView& out) const {
+  uint64_t start = recordStart(position);
+  const uint8_t* record = buffer_.get() + (start & mask_);
+  RecordHeader header;
+  std::memcpy(&header, record, sizeof(header));
+
+  out.data = record + sizeof(header);
+  out.length = header.length;
+  out.original_length = header.original_length;
+  out.interface_index = header.interface_index;
+  out.timestamp = PacketTimestamp(std::chrono::nanoseconds(header.timestamp_ns));
+  return start + header.size;
+}
+
+size_t RingBuffer::peekBatch(PacketView* out, size_t max_count) {
+  uint64_t first_position = 0;
+  uint64_t end_position = 0;
+  size_t count = claimRecords(max_count, first_position, end_position);
+  if (count == 0) {
+    return 0;
+  }
+
+  uint64_t position = first_position;
+  for (size_t i = 0; i < count; i++) {
+    position = viewRecord(position, out[i]);
+  }
+
+  consumer_.claimed_end = end_position;
+  consumer_.claimed = true;
+  return count;
+}
+
+void RingBuffer::releaseBatch() {
+  if (!consumer_.claimed) {
+    return;
+  }
+  consumer_.claimed = false;
+
+  // Only now may the producer reuse the records' bytes
+  if (policy_ == OverflowPolicy::DropOldest) {
+    consumer_.reading_position.store(NOT_READING, std::memory_order_seq_cst);
+  } else {
+    consumer_.read_position.store(consumer_.claimed_end, std::memory_order_release);
+  }
+
+  if (policy_ != OverflowPolicy::DropNewest) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (producer_.waiting.load(std::memory_order_relaxed)) {
+      signalEventFd(space_fd_);
+    }
+  }
+}
+
+size_t RingBuffer::popBatch(RawPacket* out, size_t max_count) {
+  PacketView views[PROCESSING_BATCH_SIZE];
+  size_t count = peekBatch(views, std::min(max_count, PROCESSING_BATCH_SIZE));
+
+  for (size_t i = 0; i < count; i++) {
+    out[i] = views[i];
+  }
+
+  releaseBatch();
+  return count;
+}
+
+bool RingBuffer::pop(RawPacket& out) {
+  return popBatch(&out, 1) == 1;
+}
+
+void RingBuffer::waitForData() {
+  for (unsigned spin = 0; wait_strategy_ == WaitStrategy::BusySpin || spin < RING_WAIT_SPIN_COUNT; spin++) {
+    if (!isEmpty() || takeNotification()) {
+      return;
+    }
+    cpuRelax();
+  }
+
+  if (wait_strategy_ == WaitStrategy::SpinYield) {
+    while (isEmpty() && !takeNotification()) {
+      std::this_thread::yield();
+    }
+    return;
+  }
+
+  // Read before announcing the park, so a wake between here and the futex call makes it return at once
+  uint32_t sequence = consumer_.wake_sequence.load(std::memory_order_acquire);
+  consumer_.waiting.store(true, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  if (isEmpty() && !takeNotification()) {
+    futexWait(consumer_.wake_sequence, sequence);
+  }
+
+  consumer_.waiting.store(false, std::memory_order_relaxed);
 }
 
 void RingBuffer::notifyConsumer() {
-  cv_.notify_one();
+  // Sticky until the consumer takes it, a notification sent before it starts waiting is not lost
+  consumer_.notified.store(true, std::memory_order_release);
+  wakeConsumer();
+}
+
+void RingBuffer::wakeConsumer() {
+  consumer_.wake_sequence.fetch_add(1, std::memory_order_release);
+  futexWake(consumer_.wake_sequence);
+}
+
+bool RingBuffer::takeNotification() {
+  // Plain load first, spinning must not keep stealing the cache line the notifier writes
+  return consumer_.notified.load(std::memory_order_relaxed) &&
+         consumer_.notified.exchange(false, std::memory_order_acquire);
+}
+
+size_t RingBuffer::getCapacity() const {
+  return capacity_;
+}
+
+OverflowPolicy RingBuffer::getOverflowPolicy() const {
+  return policy_;
+}
+
+WaitStrategy RingBuffer::getWaitStrategy() const {
+  return wait_strategy_;
+}
+
+uint64_t RingBuffer::getDroppedNewestCount() const {
+  return producer_.dropped_newest.read();
+}
+
+uint64_t RingBuffer::getDroppedOldestCount() const {
+  return producer_.dropped_oldest.read();
+}
+
+uint64_t RingBuffer::getBlockTimeoutCount() const {
+  return producer_.block_timeouts.read();
+}
+
+bool RingBuffer::isEmpty() const {
+  return consumer_.read_position.load(std::memory_order_acquire) ==
+         producer_.write_position.load(std::memory_order_acquire);
 }
@@ -2,29 +2,142 @@
 
 #include "../common/common.hpp"
 #include "../packets/packet_model.hpp"
-#include <array>
+#include "../stats/capture_stats.hpp"
 #include <atomic>
 #include <chrono>
-#include <condition_variable>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
-#include <mutex>
+#include <memory>
 
+// What push() does when the ring has no room for the incoming packet
+enum class OverflowPolicy {
+  DropNewest, // Refuse the incoming packet
+  DropOldest, // Evict queued packets, oldest first, until it fits. Packets the consumer holds between peekBatch()
+              // and releaseBatch() cannot be evicted; they are waited for up to the timeout, then the incoming
+              // packet is dropped as under DropNewest.
+  Block       // Wait for the consumer to free space, drop the incoming packet after the timeout
+};
+
+// How the consumer waits on an empty ring, trading CPU for wake-up latency
+enum class WaitStrategy {
+  BusySpin,  // Polls the write position without ever leaving the CPU
+  SpinYield, // Polls RING_WAIT_SPIN_COUNT times, then yields the CPU between polls
+  SpinPark   // Polls RING_WAIT_SPIN_COUNT times, then sleeps on a futex the producer wakes only if it is parked
+};
+
+// Single-producer/single-consumer byte ring. Packets are stored back to back as length-prefixed
+// records, so a 60-byte frame takes 88 bytes of the buffer instead of a full RawPacket slot.
+// The producer never touches what the consumer may be reading: under DropOldest the consumer
+// announces the batch it has claimed and the producer only reclaims space before it.
 class RingBuffer {
 public:
-  RingBuffer();
+  // Capacity is rounded up to a power of two and clamped to [RING_BUFFER_MIN_BYTES, RING_BUFFER_MAX_BYTES]
+  explicit RingBuffer(size_t capacity_bytes = RING_BUFFER_BYTES, OverflowPolicy policy = OverflowPolicy::DropNewest,
+                      std::chrono::milliseconds block_timeout = std::chrono::milliseconds(RING_BLOCK_TIMEOUT_MS),
+                      WaitStrategy wait_strategy = WaitStrategy::SpinPark);
+  ~RingBuffer();
+
+  RingBuffer(const RingBuffer&) = delete;
+  RingBuffer& operator=(const RingBuffer&) = delete;
 
+  // Producer: copies each packet (at most MAX_PACKET_SIZE bytes) into the ring and publishes the batch with
+  // one release store; the consumer is only signalled if it parked on an empty ring. Returns packets kept.
+  // A packet whose data already sits where reserve() pointed is published without being copied.
+  size_t pushBatch(const PacketView* packets, size_t count);
+  bool push(const PacketView& packet);
   bool push(const RawPacket& packet);
+  // Producer: room for the next record's data, up to max_length bytes, for a capture backend to receive into
+  // directly. Nothing is published until the bytes are pushed; null when the ring is full (push then applies
+  // the overflow policy as usual).
+  uint8_t* reserve(size_t max_length);
+
+  // Consumer: views of up to max_count queued packets, read in place from the ring. Their space is only
+  // handed back to the producer by releaseBatch(), which must be called before the next peek or pop.
+  size_t peekBatch(PacketView* out, size_t max_count);
+  void releaseBatch();
+  // Consumer: copies up to max_count packets out and releases them. Returns packets read.
+  size_t popBatch(RawPacket* out, size_t max_count);
   bool pop(RawPacket& out);
-  bool waitForData(std::chrono::milliseconds timeout);
+
+  // Consumer: returns once the ring holds data or notifyConsumer() was called, waiting per the WaitStrategy
+  void waitForData();
+  // Wakes the consumer whichever way it waits, e.g. to have it notice a stop request
   void notifyConsumer();
 
+  size_t getCapacity() const;
+  OverflowPolicy getOverflowPolicy() const;
+  WaitStrategy getWaitStrategy() const;
+  // Drop counters. Newest also counts DropOldest's timeouts, the others only move under their own policy.
+  uint64_t getDroppedNewestCount() const;
+  uint64_t getDroppedOldestCount() const;
+  uint64_t getBlockTimeoutCount() const;
+
 private:
-  std::array<RawPacket, RING_SIZE> buffer_;
-  std::atomic<size_t> write_index_;
-  std::atomic<size_t> read_index_;
+  // Precedes every record's data; size 0 marks the unused tail before the ring wraps to offset 0
+  struct RecordHeader {
+    uint32_t size; // Whole record, header and padding included, a multiple of RECORD_ALIGNMENT
+    uint32_t length;
+    uint32_t original_length;
+    int32_t interface_index;
+    int64_t timestamp_ns;
+  };
+  static constexpr size_t RECORD_ALIGNMENT = 8;
+  static constexpr uint64_t NOT_READING = UINT64_MAX;
+
+  std::unique_ptr<uint8_t[]> buffer_;
+  const size_t capacity_;
+  const size_t mask_;
+  const OverflowPolicy policy_;
+  const std::chrono::milliseconds block_timeout_;
+  const WaitStrategy wait_strategy_;
+  int space_fd_; // Signalled by the consumer while a blocked producer waits for space
+
+  // Positions are monotonic byte counts, the buffer offset is position & mask_.
+  // Each side's state sits on its own cache line; the caches spare a load of the other side's line.
+  struct alignas(CACHE_LINE_SIZE) ProducerState {
+    std::atomic<uint64_t> write_position{0};
+    std::atomic<bool> waiting{false};
+    uint64_t read_limit_cache = 0;
+    ThreadCounter dropped_newest;
+    ThreadCounter dropped_oldest;
+    ThreadCounter block_timeouts;
+  } producer_;
+
+  struct alignas(CACHE_LINE_SIZE) ConsumerState {
+    // Next record to read; the producer also advances it when evicting under DropOldest
+    std::atomic<uint64_t> read_position{0};
+    // Start of the batch claimed under DropOldest, the producer must not reclaim it before releaseBatch()
+    std::atomic<uint64_t> reading_position{NOT_READING};
+    std::atomic<bool> waiting{false};     // Parked on wake_sequence, only under SpinPark
+    std::atomic<uint32_t> wake_sequence{0}; // Futex word, bumped by every wake-up
+    std::atomic<bool> notified{false};      // Set by notifyConsumer(), cleared when waitForData() returns on it
+    uint64_t write_position_cache = 0;
+    uint64_t claimed_end = 0; // End of the range handed out by peekBatch(), freed by releaseBatch()
+    bool claimed = false;
+  } consumer_;
 
-  std::mutex mutex_;
-  std::condition_variable cv_;
+  size_t recordSize(size_t length) const;
+  // Producer: writes one record at write_position, publishing what is pending before it waits or evicts
+  bool appendRecord(const PacketView& packet, uint64_t& write_position, uint64_t& published_position);
+  void publish(uint64_t write_position);
+  // Producer: free bytes ahead of write_position, reloading the consumer's position when the cache is short
+  size_t freeSpace(uint64_t write_position, size_t needed);
+  // Producer: advances the read position past the oldest record, false when nothing can be evicted
+  bool evictOldest(uint64_t write_position);
+  // Producer: true once needed bytes are free, evicting first under DropOldest
+  bool makeSpace(uint64_t write_position, size_t needed);
+  // Producer: makeSpace() until it succeeds or block_timeout_ passes, sleeping until releaseBatch() in between
+  bool waitForSpace(uint64_t write_position, size_t needed);
+  // Consumer: claims up to max_count records from read_position, returns how many and the claimed range
+  size_t claimRecords(size_t max_count, uint64_t& first_position, uint64_t& end_position);
+  // Skips a wrap marker at position, if any
+  uint64_t recordStart(uint64_t position) const;
+  // Points out at the record at position (past any marker), returns the position after it
+  uint64_t viewRecord(uint64_t position, PacketView& out) const;
+  bool isEmpty() const;
+  // Unparks the consumer if it sleeps on wake_sequence
+  void wakeConsumer();
+  // Consumer: clears a pending notifyConsumer(), true if there was one
+  bool takeNotification();
 };
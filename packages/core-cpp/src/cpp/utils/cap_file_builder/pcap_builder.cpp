@@ -1,8 +1,13 @@
 #include "pcap_builder.hpp"
+#include <algorithm>
 #include <chrono>
 #include <iostream>
 
-PcapBuilder::PcapBuilder(const std::string& filename) : filename_(filename), file_(nullptr), is_open_(false) {}
+static_assert(sizeof(PcapGlobalHeader) == PCAP_GLOBAL_HEADER_SIZE, "PCAP global header layout");
+static_assert(sizeof(PcapPacketHeader) == PCAP_PACKET_HEADER_SIZE, "PCAP packet header layout");
+
+PcapBuilder::PcapBuilder(const std::string& filename, uint32_t snaplen)
+    : filename_(filename), snaplen_(snaplen), file_(nullptr), is_open_(false) {}
 
 PcapBuilder::~PcapBuilder() {
   if (is_open_) {
@@ -67,6 +72,7 @@ bool PcapBuilder::isOpen() const {
 
 bool PcapBuilder::writeGlobalHeader() {
   PcapGlobalHeader header;
+  header.max_capture_length = snaplen_;
   file_->write(reinterpret_cast<const char*>(&header), sizeof(PcapGlobalHeader));
   return !file_->fail();
 }
@@ -74,14 +80,15 @@ bool PcapBuilder::writeGlobalHeader() {
 PcapPacketHeader PcapBuilder::createPacketHeader(const RawPacket& packet) {
   PcapPacketHeader header;
 
-  // Convert timestamp to seconds and microseconds
+  // Convert timestamp to seconds and nanoseconds
   auto time_since_epoch = packet.timestamp.time_since_epoch();
   auto seconds = std::chrono::duration_cast<std::chrono::seconds>(time_since_epoch);
-  auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(time_since_epoch - seconds);
+  auto nanoseconds = time_since_epoch - seconds;
 
   header.timestamp_seconds = static_cast<uint32_t>(seconds.count());
-  header.timestamp_microseconds = static_cast<uint32_t>(microseconds.count());
+  header.timestamp_nanoseconds = static_cast<uint32_t>(nanoseconds.count());
   header.captured_length = static_cast<uint32_t>(packet.length);
+  header.original_length = static_cast<uint32_t>(std::max(packet.original_length, packet.length));
 
   return header;
 }
@@ -8,7 +8,8 @@
 
 class PcapBuilder {
 public:
-  explicit PcapBuilder(const std::string& filename);
+  // snaplen is recorded in the global header, frames longer than it are expected to be truncated
+  explicit PcapBuilder(const std::string& filename, uint32_t snaplen = MAX_PACKET_SIZE);
   ~PcapBuilder();
 
   // Initialize and open the PCAP file for writing
@@ -25,6 +26,7 @@ public:
 
 private:
   std::string filename_;
+  uint32_t snaplen_;
   std::unique_ptr<std::ofstream> file_;
   bool is_open_;
 
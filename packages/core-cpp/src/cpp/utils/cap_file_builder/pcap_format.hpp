@@ -6,7 +6,7 @@
 // Reference: https://wiki.wireshark.org/Development/LibpcapFileFormat
 
 struct PcapGlobalHeader {
-  uint32_t magic_number = 0xa1b2c3d4;  // Magic number for PCAP files
+  uint32_t magic_number = 0xa1b23c4d;  // Magic number for nanosecond-resolution PCAP files
   uint16_t version_major = 2;          // Major version number
   uint16_t version_minor = 4;          // Minor version number
   int32_t timezone_offset = 0;         // GMT to local correction
@@ -17,6 +17,7 @@ struct PcapGlobalHeader {
 
 struct PcapPacketHeader {
   uint32_t timestamp_seconds;      // Timestamp seconds since epoch
-  uint32_t timestamp_microseconds; // Timestamp microseconds
+  uint32_t timestamp_nanoseconds;  // Timestamp nanoseconds
   uint32_t captured_length;        // Number of bytes captured
+  uint32_t original_length;        // Frame length on the wire
 };
\ No newline at end of file
@@ -1,10 +1,55 @@
 #pragma once
 
+#include <array>
 #include <cstddef>
+#include <cstdint>
 
 // Network packet capture constants
 constexpr size_t MAX_PACKET_SIZE = 9000; // Maximum packet size (supports jumbo frames)
-constexpr size_t RING_SIZE = 128;        // Ring buffer size for packet queue
+
+// Byte ring between each capture thread and its processing thread (capacity is a power of two)
+constexpr size_t RING_BUFFER_BYTES = 2 << 20;     // 2 MiB, ~24k minimum-size frames or ~230 jumbo frames
+constexpr size_t RING_BUFFER_MIN_BYTES = 1 << 16; // Room for several maximum-size records
+constexpr size_t RING_BUFFER_MAX_BYTES = 1 << 30;
+constexpr long RING_BLOCK_TIMEOUT_MS = 100;       // Longest a producer waits for space under Block (or DropOldest)
+constexpr size_t CACHE_LINE_SIZE = 64;
+constexpr unsigned RING_WAIT_SPIN_COUNT = 4096;   // Polls of an empty ring before a consumer yields or parks
+constexpr size_t CAPTURE_BATCH_SIZE = 64;    // Frames a capture thread pushes into the ring with one publish
+constexpr size_t PROCESSING_BATCH_SIZE = 32; // Frames a processing thread pops, parses and delivers at once
+
+// Packet buffer pool for packets kept past their ring record (merge queue, N-API callback, JS ArrayBuffer)
+constexpr std::array<uint32_t, 3> PACKET_POOL_SIZE_CLASSES = {256, 2048, MAX_PACKET_SIZE}; // Buffer capacities, ascending
+constexpr size_t PACKET_POOL_SLAB_BYTES = 1 << 18; // Carved into one size class whenever its freelist runs dry
+constexpr size_t CALLBACK_POOL_SIZE = 1024;        // Idle N-API callback payloads kept for reuse
+
+// TPACKET_V3 RX ring defaults (block size must be a multiple of the page size)
+constexpr uint32_t RX_RING_BLOCK_SIZE = 1 << 20;   // 1 MiB per block
+constexpr uint32_t RX_RING_BLOCK_COUNT = 32;       // 32 MiB of kernel-filled ring
+constexpr uint32_t RX_RING_FRAME_SIZE = 1 << 11;   // Nominal frame slot, V3 packs frames tightly
+constexpr uint32_t RX_RING_BLOCK_TIMEOUT_MS = 10;  // Kernel retires a partially filled block after this
+
+// Fan-out capture
+constexpr size_t MAX_FANOUT_WORKERS = 64;       // Upper bound on sockets in one PACKET_FANOUT group
+constexpr size_t MAX_CAPTURE_WORKERS = 256;     // Upper bound on sockets per session, all interfaces included
+constexpr size_t MERGE_QUEUE_DEPTH = 1024;      // Parsed packets buffered per worker before back-pressure
+constexpr long MERGE_REORDER_WINDOW_US = 2000;  // Longest a packet waits for slower workers before release
+
+// Parser thread pool behind each processing thread
+constexpr size_t MAX_PARSER_THREADS = 64;            // Upper bound on parser threads per capture worker
+constexpr size_t PARSER_POOL_BATCHES_PER_THREAD = 4; // Batches in flight per parser thread, sizes the reorder buffer
+
+// AF_XDP capture (ring sizes must be powers of two)
+constexpr uint32_t XDP_FRAME_SIZE = 4096;  // One UMEM chunk per frame, no multi-buffer jumbo frames
+constexpr uint32_t XDP_FRAME_COUNT = 4096; // 16 MiB UMEM, also the fill and RX ring sizes
+
+// Capture filter
+constexpr uint32_t FILTER_ACCEPT_LENGTH = 262144; // Bytes kept by an accepting BPF program (whole frame)
+constexpr size_t FILTER_MAX_PATH_DEPTH = 3;       // Protocol hops followed from the entry file when resolving keywords
+
+// Protocol parser
+constexpr size_t PARSER_MAX_LAYERS = 32; // Layers decoded per packet, bounds protocol cycles such as stacked MPLS labels
+// Leading layers (L2, L3) parseBatch() decodes with the SIMD field-gather kernel
+constexpr size_t PARSER_BATCH_GATHER_LAYERS = 2;
 
 // PCAP file format constants
 constexpr size_t PCAP_GLOBAL_HEADER_SIZE = 24; // Size of PCAP global header
@@ -1,12 +1,59 @@
 #include "packet_model.hpp"
+#include <algorithm>
 #include <cstdio>
+#include <cstring>
 
-RawPacket::RawPacket() : timestamp(std::chrono::system_clock::now()) {}
+RawPacket::RawPacket() : timestamp(std::chrono::time_point_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now())) {}
+
+RawPacket::RawPacket(const RawPacket& other)
+    : length(other.length), original_length(other.original_length), interface_index(other.interface_index),
+      timestamp(other.timestamp), valid(other.valid) {
+  std::memcpy(data.data(), other.data.data(), std::min(length, data.size()));
+}
+
+RawPacket::RawPacket(const PacketView& view) {
+  *this = view;
+}
+
+RawPacket& RawPacket::operator=(const RawPacket& other) {
+  if (this != &other) {
+    length = other.length;
+    original_length = other.original_length;
+    interface_index = other.interface_index;
+    timestamp = other.timestamp;
+    valid = other.valid;
+    std::memcpy(data.data(), other.data.data(), std::min(length, data.size()));
+  }
+  return *this;
+}
+
+RawPacket& RawPacket::operator=(const PacketView& view) {
+  length = std::min(view.length, MAX_PACKET_SIZE);
+  original_length = view.original_length;
+  interface_index = view.interface_index;
+  timestamp = view.timestamp;
+  valid = view.data != nullptr;
+  if (valid) {
+    std::memcpy(data.data(), view.data, length);
+  }
+  return *this;
+}
+
+PacketView RawPacket::view() const {
+  PacketView result;
+  result.data = valid ? data.data() : nullptr;
+  result.length = length;
+  result.original_length = original_length;
+  result.interface_index = interface_index;
+  result.timestamp = timestamp;
+  return result;
+}
 
 std::string RawPacket::toString() const {
   std::string result = "────────────────────────────────────────\n";
   result += "RawPacket\n";
   result += "length=" + std::to_string(length) + ", ";
+  result += "original_length=" + std::to_string(original_length) + ", ";
   result += "valid=" + std::string(valid ? "true" : "false") + "\n";
 
   // Each line contains up to 11 bytes in hexadecimal format
@@ -27,27 +74,3 @@ std::string RawPacket::toString() const {
   result += "────────────────────────────────────────\n";
   return result;
 }
-
-Napi::Object RawPacket::toNapiObject(Napi::Env& env) const {
-  Napi::Object obj = Napi::Object::New(env);
-
-  if (length > 0 && length <= MAX_PACKET_SIZE) {
-    Napi::ArrayBuffer buffer = Napi::ArrayBuffer::New(env, length);
-    std::memcpy(buffer.Data(), data.data(), length);
-    Napi::Uint8Array data_array = Napi::Uint8Array::New(env, length, buffer, 0);
-    obj.Set("data", data_array);
-  } else {
-    Napi::Uint8Array data_array = Napi::Uint8Array::New(env, 0);
-    obj.Set("data", data_array);
-  }
-
-  obj.Set("length", Napi::Number::New(env, static_cast<double>(length)));
-
-  auto epoch = timestamp.time_since_epoch();
-  auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(epoch).count();
-  obj.Set("timestamp", Napi::Number::New(env, static_cast<double>(millis)));
-
-  obj.Set("valid", Napi::Boolean::New(env, valid));
-
-  return obj;
-}
@@ -8,13 +8,38 @@
 #include <string>
 #include <napi.h>
 
+// Kernel receive time, kept at nanosecond resolution whatever system_clock's own period is
+using PacketTimestamp = std::chrono::time_point<std::chrono::system_clock, std::chrono::nanoseconds>;
+
+class PacketBuffer;
+
+// Captured frame borrowed from a buffer someone else owns (capture backend, RingBuffer, RawPacket, PacketBuffer),
+// only valid for as long as that owner hands it out
+struct PacketView {
+  const uint8_t* data = nullptr;
+  size_t length = 0;          // Bytes at data
+  size_t original_length = 0; // Frame size on the wire
+  int interface_index = -1;
+  PacketTimestamp timestamp;
+  PacketBuffer* buffer = nullptr; // Pooled buffer holding data, if any, see PacketPool::share
+};
+
 struct RawPacket {
   std::array<uint8_t, MAX_PACKET_SIZE> data;
-  size_t length = 0;
-  std::chrono::system_clock::time_point timestamp;
+  size_t length = 0;          // Bytes held in data, at most the capture's snap length
+  size_t original_length = 0; // Frame size on the wire, larger than length when truncated
+  int interface_index = -1;   // Kernel ifindex of the capturing interface
+  PacketTimestamp timestamp;
   bool valid = false;
 
   RawPacket();
+  // Copies only the captured bytes, not the whole MAX_PACKET_SIZE array
+  RawPacket(const RawPacket& other);
+  explicit RawPacket(const PacketView& view);
+  RawPacket& operator=(const RawPacket& other);
+  RawPacket& operator=(const PacketView& view);
+  // Borrowed view of this packet, data is null when the packet is not valid
+  PacketView view() const;
   std::string toString() const;
   Napi::Object toNapiObject(Napi::Env& env) const;
 };
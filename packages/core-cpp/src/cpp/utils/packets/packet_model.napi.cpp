@@ -0,0 +1,29 @@
+#include "packet_model.hpp"
+#include <cstring>
+
+Napi::Object RawPacket::toNapiObject(Napi::Env& env) const {
+  Napi::Object obj = Napi::Object::New(env);
+
+  if (length > 0 && length <= MAX_PACKET_SIZE) {
+    Napi::ArrayBuffer buffer = Napi::ArrayBuffer::New(env, length);
+    std::memcpy(buffer.Data(), data.data(), length);
+    Napi::Uint8Array data_array = Napi::Uint8Array::New(env, length, buffer, 0);
+    obj.Set("data", data_array);
+  } else {
+    Napi::Uint8Array data_array = Napi::Uint8Array::New(env, 0);
+    obj.Set("data", data_array);
+  }
+
+  obj.Set("length", Napi::Number::New(env, static_cast<double>(length)));
+  obj.Set("originalLength", Napi::Number::New(env, static_cast<double>(original_length)));
+  obj.Set("interfaceIndex", Napi::Number::New(env, interface_index));
+
+  auto epoch = timestamp.time_since_epoch();
+  auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(epoch).count();
+  obj.Set("timestamp", Napi::Number::New(env, static_cast<double>(millis)));
+  obj.Set("timestampNs", Napi::BigInt::New(env, static_cast<int64_t>(epoch.count())));
+
+  obj.Set("valid", Napi::Boolean::New(env, valid));
+
+  return obj;
+}
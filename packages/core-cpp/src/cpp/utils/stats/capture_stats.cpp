@@ -0,0 +1,17 @@
+#include "capture_stats.hpp"
+
+CaptureStats& CaptureStats::operator+=(const CaptureStats& other) {
+  kernel_received += other.kernel_received;
+  kernel_dropped += other.kernel_dropped;
+  captured += other.captured;
+  ring_dropped_newest += other.ring_dropped_newest;
+  ring_dropped_oldest += other.ring_dropped_oldest;
+  ring_block_timeouts += other.ring_block_timeouts;
+  oversize += other.oversize;
+  parsed += other.parsed;
+  delivered += other.delivered;
+  callback_backlog += other.callback_backlog;
+  protocol_reloads += other.protocol_reloads;
+  threads.insert(threads.end(), other.threads.begin(), other.threads.end());
+  return *this;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <napi.h>
+#include <string>
+#include <vector>
+
+// Counter with a single writer thread: a relaxed load/store pair, no locked read-modify-write on the hot path.
+// Readers on other threads see a slightly stale but never torn value.
+class ThreadCounter {
+public:
+  void increment(uint64_t amount = 1) {
+    value_.store(value_.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+  }
+  uint64_t read() const { return value_.load(std::memory_order_relaxed); }
+  // Only while the writer thread is not running
+  void reset() { value_.store(0, std::memory_order_relaxed); }
+
+private:
+  std::atomic<uint64_t> value_{0};
+};
+
+// Where one sniffer thread runs, read back from the kernel rather than taken from the requested options
+struct ThreadPlacement {
+  std::string role;              // "capture", "processing" or "parser"
+  size_t worker = 0;             // Capture worker index, one per socket
+  int interface_index = -1;      // Kernel ifindex the worker captures
+  int64_t tid = 0;               // Kernel thread id
+  int cpu = -1;                  // CPU the thread last ran on
+  std::vector<int> allowed_cpus; // Current affinity mask
+  std::string policy;            // "other", "fifo", "rr", "batch" or "idle"
+  int priority = 0;              // Real-time priority, 0 under the time-sharing policies
+  int nice = 0;
+  std::string error;             // Requested settings the kernel refused, empty when all were applied
+
+  Napi::Object toNapiObject(Napi::Env& env) const;
+};
+
+// Session counters, summed from the per-thread counters when read
+struct CaptureStats {
+  uint64_t kernel_received = 0;  // PACKET_STATISTICS tp_packets, frames the socket filter accepted
+  uint64_t kernel_dropped = 0;   // PACKET_STATISTICS tp_drops, no room left in the socket queue or ring
+  uint64_t captured = 0;         // Frames the capture threads handed to the pipeline
+  uint64_t ring_dropped_newest = 0; // Frames a full RingBuffer refused (DropNewest, or DropOldest blocked by the consumer's batch)
+  uint64_t ring_dropped_oldest = 0; // Queued frames evicted to make room (OverflowPolicy::DropOldest)
+  uint64_t ring_block_timeouts = 0; // Frames dropped after waiting for room too long (OverflowPolicy::Block)
+  uint64_t oversize = 0;         // Frames longer than MAX_PACKET_SIZE, truncated to it
+  uint64_t parsed = 0;           // Frames run through the parser
+  uint64_t delivered = 0;        // Packets handed to the PacketCallback
+  uint64_t callback_backlog = 0; // Delivered but not yet consumed by an asynchronous callback
+  uint64_t protocol_reloads = 0; // Parsers swapped in with NetworkSniffer::setParser() during the session
+  std::vector<ThreadPlacement> threads; // Capture and processing threads of every worker
+
+  CaptureStats& operator+=(const CaptureStats& other);
+  Napi::Object toNapiObject(Napi::Env& env) const;
+};
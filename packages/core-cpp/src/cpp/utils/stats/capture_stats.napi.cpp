@@ -0,0 +1,50 @@
+#include "capture_stats.hpp"
+
+Napi::Object CaptureStats::toNapiObject(Napi::Env& env) const {
+  Napi::Object obj = Napi::Object::New(env);
+
+  obj.Set("kernelReceived", Napi::Number::New(env, static_cast<double>(kernel_received)));
+  obj.Set("kernelDropped", Napi::Number::New(env, static_cast<double>(kernel_dropped)));
+  obj.Set("captured", Napi::Number::New(env, static_cast<double>(captured)));
+  obj.Set("ringDroppedNewest", Napi::Number::New(env, static_cast<double>(ring_dropped_newest)));
+  obj.Set("ringDroppedOldest", Napi::Number::New(env, static_cast<double>(ring_dropped_oldest)));
+  obj.Set("ringBlockTimeouts", Napi::Number::New(env, static_cast<double>(ring_block_timeouts)));
+  obj.Set("oversize", Napi::Number::New(env, static_cast<double>(oversize)));
+  obj.Set("parsed", Napi::Number::New(env, static_cast<double>(parsed)));
+  obj.Set("delivered", Napi::Number::New(env, static_cast<double>(delivered)));
+  obj.Set("callbackBacklog", Napi::Number::New(env, static_cast<double>(callback_backlog)));
+  obj.Set("protocolReloads", Napi::Number::New(env, static_cast<double>(protocol_reloads)));
+
+  Napi::Array thread_arr = Napi::Array::New(env, threads.size());
+  for (size_t i = 0; i < threads.size(); i++) {
+    thread_arr.Set(static_cast<uint32_t>(i), threads[i].toNapiObject(env));
+  }
+  obj.Set("threads", thread_arr);
+
+  return obj;
+}
+
+Napi::Object ThreadPlacement::toNapiObject(Napi::Env& env) const {
+  Napi::Object obj = Napi::Object::New(env);
+
+  obj.Set("role", Napi::String::New(env, role));
+  obj.Set("worker", Napi::Number::New(env, static_cast<double>(worker)));
+  obj.Set("interfaceIndex", Napi::Number::New(env, interface_index));
+  obj.Set("tid", Napi::Number::New(env, static_cast<double>(tid)));
+  obj.Set("cpu", Napi::Number::New(env, cpu));
+
+  Napi::Array cpu_arr = Napi::Array::New(env, allowed_cpus.size());
+  for (size_t i = 0; i < allowed_cpus.size(); i++) {
+    cpu_arr.Set(static_cast<uint32_t>(i), Napi::Number::New(env, allowed_cpus[i]));
+  }
+  obj.Set("allowedCpus", cpu_arr);
+
+  obj.Set("policy", Napi::String::New(env, policy));
+  obj.Set("priority", Napi::Number::New(env, priority));
+  obj.Set("nice", Napi::Number::New(env, nice));
+  if (!error.empty()) {
+    obj.Set("error", Napi::String::New(env, error));
+  }
+
+  return obj;
+}
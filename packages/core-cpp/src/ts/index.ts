@@ -11,6 +11,15 @@ export type {
     RawPacketData,
     PacketData,
     PacketCallback,
+    ParseMode,
+    ParserBackend,
+    CaptureMode,
+    OverflowPolicy,
+    SniffOptions,
+    SnifferStats,
+    SnifferThreadPlacement,
+    ThreadOptions,
+    WaitStrategy,
 } from './types/basics.js'
 
 export const VERSION = '0.0.1'
@@ -1,4 +1,4 @@
-import type { PacketCallback } from '../types/basics.js'
+import type { PacketCallback, ParserBackend, SniffOptions, SnifferStats } from '../types/basics.js'
 import addon from '../addon.js'
 import { dirname, resolve } from 'node:path'
 import { fileURLToPath } from 'node:url'
@@ -86,7 +86,11 @@ export function isSnifferPrivileged(): boolean {
 export class NetworkSniffer {
     private nativeInstance: InstanceType<typeof addon.NetworkSniffer>
 
-    constructor(protocolsPath?: string) {
+    /**
+     * @param protocolsPath Entry protocol file (defaults to the bundled protocols)
+     * @param parser 'interpreted' (the default) or 'generated', see `ParserBackend`
+     */
+    constructor(protocolsPath?: string, parser: ParserBackend = 'interpreted') {
         if (!isSnifferPrivileged()) {
             throw new Error(
                 'Insufficient privileges: raw sockets require root privileges. Please run the application as root/administrator.',
@@ -104,7 +108,7 @@ export class NetworkSniffer {
         const path = protocolsPath ?? getProtocolsPath()
 
         try {
-            this.nativeInstance = new addon.NetworkSniffer(path)
+            this.nativeInstance = new addon.NetworkSniffer(path, parser)
         } catch (error) {
             throw new Error(
                 `Failed to create NetworkSniffer: ${error instanceof Error ? error.message : 'Unknown error'}`,
@@ -113,16 +117,24 @@ export class NetworkSniffer {
     }
 
     /**
-     * Start sniffing on the specified network interface
+     * Start sniffing on the specified network interface(s)
+     *
+     * Several interfaces are captured in one session: packets from all of them
+     * reach the callback as a single timestamp-ordered stream, tagged with
+     * `raw.interfaceIndex`.
      *
-     * @param interfaceName Network interface name (e.g., 'eth0', 'en0')
+     * @param interfaceName Network interface name (e.g., 'eth0', 'en0') or a list of names
      * @param callback Function called for each captured packet
+     * @param options Capture backend options (defaults to one recv() per frame)
      * @returns true if sniffing started successfully, false otherwise
      *
      * @note Requires elevated privileges (sudo) for raw socket access
      */
-    startSniffing(interfaceName: string, callback: PacketCallback): boolean {
-        if (!interfaceName || interfaceName.trim().length === 0) {
+    startSniffing(interfaceName: string | string[], callback: PacketCallback, options?: SniffOptions): boolean {
+        const interfaceNames = (Array.isArray(interfaceName) ? interfaceName : [interfaceName]).map((name) =>
+            typeof name === 'string' ? name.trim() : '',
+        )
+        if (interfaceNames.length === 0 || interfaceNames.some((name) => name.length === 0)) {
             throw new Error('Interface name cannot be empty')
         }
 
@@ -131,7 +143,11 @@ export class NetworkSniffer {
         }
 
         try {
-            return this.nativeInstance.startSniffing(interfaceName.trim(), callback)
+            return this.nativeInstance.startSniffing(
+                Array.isArray(interfaceName) ? interfaceNames : interfaceNames[0],
+                callback,
+                options,
+            )
         } catch (error) {
             throw new Error(
                 `Failed to start sniffing: ${error instanceof Error ? error.message : 'Unknown error'}`,
@@ -165,4 +181,38 @@ export class NetworkSniffer {
             )
         }
     }
+
+    /**
+     * Reload the protocol files, e.g. after one was edited, without stopping
+     * the capture. They are loaded off the JS thread into a new parser of the
+     * same kind, which each processing thread picks up before its next batch.
+     * If the entry file fails to load the current protocols stay in use.
+     * @param protocolsPath Entry protocol file (defaults to the current one)
+     * @returns Resolves once the new parser is swapped in
+     */
+    async reloadProtocols(protocolsPath?: string): Promise<void> {
+        try {
+            await this.nativeInstance.reloadProtocols(protocolsPath)
+        } catch (error) {
+            throw new Error(
+                `Failed to reload protocols: ${error instanceof Error ? error.message : 'Unknown error'}`,
+            )
+        }
+    }
+
+    /**
+     * Read loss and throughput counters for the current session, or the last
+     * session's final values once stopped. Counters are per-thread and only
+     * summed here, so polling is cheap.
+     * @returns Kernel, ring, parser and callback counters
+     */
+    getStats(): SnifferStats {
+        try {
+            return this.nativeInstance.getStats()
+        } catch (error) {
+            throw new Error(
+                `Failed to read sniffer stats: ${error instanceof Error ? error.message : 'Unknown error'}`,
+            )
+        }
+    }
 }
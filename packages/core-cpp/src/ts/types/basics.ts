@@ -7,8 +7,16 @@ export type ParsedPacket = ParsedProtocolLayer[]
 
 export interface RawPacketData<BaseType = Uint8Array> {
     data: BaseType
+    /** Bytes in `data`, at most the session's snap length */
     length: number
+    /** Frame length on the wire, larger than `length` when the frame was truncated */
+    originalLength: number
+    /** Kernel interface index (ifindex) of the interface that captured the frame */
+    interfaceIndex: number
+    /** Kernel receive time in milliseconds since the epoch */
     timestamp: number
+    /** Kernel receive time in nanoseconds since the epoch */
+    timestampNs: bigint
     valid: boolean
 }
 
@@ -18,3 +26,165 @@ export interface PacketData {
 }
 
 export type PacketCallback = (packet: PacketData) => void
+
+export type CaptureMode = 'recv' | 'ring' | 'xdp'
+
+export type OverflowPolicy = 'drop-newest' | 'drop-oldest' | 'block'
+
+export type WaitStrategy = 'busy-spin' | 'spin-yield' | 'spin-park'
+
+export type ParseMode = 'eager' | 'lazy'
+
+/**
+ * 'interpreted' reads the protocol files at runtime. 'generated' runs dissectors compiled from
+ * the bundled protocol files at build time, and interprets files that differ from them.
+ */
+export type ParserBackend = 'interpreted' | 'generated'
+
+/**
+ * Placement applied by each capture or processing thread to itself when it starts.
+ * Settings the kernel refuses are reported in `SnifferStats.threads[].error`.
+ */
+export interface ThreadOptions {
+    /** CPUs the thread may run on, e.g. the core handling the NIC's IRQ. Defaults to the process mask */
+    cpus?: number[]
+    /** 1 to 99 runs the thread under SCHED_FIFO at that priority (needs CAP_SYS_NICE) */
+    fifoPriority?: number
+    /** Nice value from -20 to 19, ignored under SCHED_FIFO */
+    nice?: number
+}
+
+export interface SniffOptions {
+    /**
+     * 'recv' reads one frame per syscall, 'ring' maps a TPACKET_V3 ring (falls back to 'recv'),
+     * 'xdp' redirects one RX queue into an AF_XDP socket (falls back to 'ring'; no fan-out,
+     * timestamps taken in user space).
+     *
+     * **'xdp' is not passive:** every frame arriving on the redirected queue goes to the
+     * sniffer instead of the kernel stack for as long as the capture runs, so host traffic on
+     * that queue (SSH sessions included) stops. Use it on a dedicated capture interface or
+     * queue, e.g. one fed by a mirror port or an ethtool flow steering rule.
+     */
+    mode?: CaptureMode
+    /** Size in bytes of one ring block, must be a multiple of the page size */
+    ringBlockSize?: number
+    /** Number of blocks in the ring */
+    ringBlockCount?: number
+    /** RX queue redirected to the AF_XDP socket, taken away from the kernel stack. Defaults to 0 */
+    xdpQueue?: number
+    /** 4 KiB UMEM frames, a power of two. Defaults to 4096 */
+    xdpFrameCount?: number
+    /** Attach in generic (skb) mode even where the driver has a native XDP hook. Defaults to false */
+    xdpGeneric?: boolean
+    /**
+     * Sockets joined into one PACKET_FANOUT hash group, each parsed on its own thread.
+     * Packets are merged back into timestamp order before the callback. Defaults to 1.
+     */
+    fanoutWorkers?: number
+    /**
+     * Parser threads behind each capture socket (1 to 64). Above 1 (the default), batches are
+     * copied out of the queue and parsed on that many threads, then handed to the callback in
+     * capture order. `processingThread` applies to these threads as well.
+     */
+    parserThreads?: number
+    /**
+     * Bytes kept per frame (1 to 9000, the default). The kernel truncates frames before
+     * they are copied, `raw.originalLength` still reports the full size.
+     */
+    snaplen?: number
+    /**
+     * Kernel-side capture filter, e.g. `'tcp port 443 and not host 10.0.0.1'`.
+     * Supports `and`/`or`/`not`, parentheses, protocol names from the protocol files
+     * (plus `ip`, `ip6`, `icmp6`, `ether`) and `[src|dst] host|net|port` qualifiers.
+     */
+    filter?: string
+    /**
+     * Bytes of the queue between each capture thread and its parser thread (64 KiB to 1 GiB,
+     * rounded up to a power of two; default 2 MiB). Frames are packed back to back, so small
+     * frames queue in far larger numbers than jumbo frames.
+     */
+    bufferBytes?: number
+    /**
+     * What a capture thread does when that queue is full: drop the incoming frame (the default),
+     * evict the oldest queued frames, or wait up to `blockTimeoutMs` for the parser to catch up.
+     * Blocking pushes back into the kernel ring, where further loss shows as `kernelDropped`.
+     * 'drop-oldest' cannot evict the batch the parser is working on; when only that batch stands
+     * in the way, it waits up to `blockTimeoutMs` for it, then drops the incoming frame.
+     */
+    overflow?: OverflowPolicy
+    /** Longest wait under 'block' (or 'drop-oldest', see `overflow`) before the frame is dropped. Defaults to 100 */
+    blockTimeoutMs?: number
+    /**
+     * How a parser thread waits for frames once its queue is empty. 'busy-spin' keeps polling and
+     * holds a core per parser thread for the lowest latency. 'spin-yield' polls briefly, then gives
+     * the CPU away between polls. 'spin-park' (the default) polls briefly, then sleeps until the
+     * capture thread wakes it.
+     */
+    waitStrategy?: WaitStrategy
+    /**
+     * 'eager' (the default) decodes every field of every layer on the parser thread. 'lazy' only
+     * decodes the fields that select the next layer; each layer of `parsed` is then decoded the
+     * first time it is read, so callbacks that look at a few layers skip the rest.
+     */
+    parseMode?: ParseMode
+    /** Affinity and scheduling for every capture thread (one per socket) */
+    captureThread?: ThreadOptions
+    /** Affinity and scheduling for every processing thread, and every parser thread with `parserThreads` */
+    processingThread?: ThreadOptions
+}
+
+/**
+ * Capture session counters, see `NetworkSniffer.getStats()`
+ */
+export interface SnifferStats {
+    /** Frames the kernel socket filter accepted (PACKET_STATISTICS) */
+    kernelReceived: number
+    /** Frames the kernel dropped because the socket queue or ring was full */
+    kernelDropped: number
+    /** Frames the capture threads handed to the pipeline */
+    captured: number
+    /**
+     * Frames refused because the queue between capture and parser was full ('drop-newest'), or
+     * because the parser held on to the frames 'drop-oldest' would evict for `blockTimeoutMs`
+     */
+    ringDroppedNewest: number
+    /** Queued frames evicted to make room for new ones ('drop-oldest') */
+    ringDroppedOldest: number
+    /** Frames dropped after the capture thread waited `blockTimeoutMs` for room ('block') */
+    ringBlockTimeouts: number
+    /** Frames longer than the 9000-byte packet buffer, truncated to it */
+    oversize: number
+    /** Frames run through the protocol parser */
+    parsed: number
+    /** Packets handed to the callback */
+    delivered: number
+    /** Packets queued for the JS callback that it has not run yet */
+    callbackBacklog: number
+    /** Protocol sets swapped in with `NetworkSniffer.reloadProtocols()` during the session */
+    protocolReloads: number
+    /** Where each capture and processing thread actually runs */
+    threads: SnifferThreadPlacement[]
+}
+
+/**
+ * Placement of one sniffer thread as reported by the kernel
+ */
+export interface SnifferThreadPlacement {
+    role: 'capture' | 'processing' | 'parser'
+    /** Capture worker index, one per socket */
+    worker: number
+    /** Kernel interface index the worker captures */
+    interfaceIndex: number
+    /** Kernel thread id */
+    tid: number
+    /** CPU the thread last ran on */
+    cpu: number
+    /** Current affinity mask */
+    allowedCpus: number[]
+    policy: 'other' | 'fifo' | 'rr' | 'batch' | 'idle' | 'unknown'
+    /** Real-time priority, 0 under the time-sharing policies */
+    priority: number
+    nice: number
+    /** Requested settings the kernel refused */
+    error?: string
+}
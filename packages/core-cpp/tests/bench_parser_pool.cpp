@@ -0,0 +1,113 @@
+#include "../src/cpp/parser/packet_parser.hpp"
+#include "../src/cpp/sniffer/parser_pool.hpp"
+#include "./packet_corpus.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ParserPool throughput at 1 to N parser threads, replaying pcap files given as arguments (the synthetic corpus of
+// test_parse_batch without any) the way a processing thread feeds it: batches of PROCESSING_BATCH_SIZE submitted
+// from one owner thread and delivered in order. Scaling is only meaningful with N cores to spare.
+//
+//   bench_parser_pool [--threads N] [--mode eager|lazy] [capture.pcap ...]
+
+namespace {
+
+constexpr size_t MIN_PACKETS = 2000000;
+constexpr double MIN_SECONDS = 1.0;
+
+// Packets per second, replaying the corpus until both minimums are reached
+double replay(const ParserModel& parser, size_t thread_count, ParseMode mode, const std::vector<PacketView>& views) {
+  ParserPool pool(parser, thread_count, mode);
+  size_t delivered = 0;
+  size_t layers = 0;
+  ParsedBatchSink sink = [&](const PacketView*, ParsedPacket* parsed, size_t count) {
+    delivered += count;
+    for (size_t i = 0; i < count; i++) {
+      layers += parsed[i].layers.size();
+    }
+  };
+
+  size_t submitted = 0;
+  auto start = std::chrono::steady_clock::now();
+  double seconds = 0;
+  while (submitted < MIN_PACKETS || seconds < MIN_SECONDS) {
+    for (size_t offset = 0; offset < views.size(); offset += PROCESSING_BATCH_SIZE) {
+      while (pool.isFull()) {
+        pool.deliver(sink, true);
+      }
+      size_t count = std::min(PROCESSING_BATCH_SIZE, views.size() - offset);
+      pool.submit(views.data() + offset, count);
+      submitted += count;
+      pool.deliver(sink, false);
+    }
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+  while (!pool.isIdle()) {
+    pool.deliver(sink, true);
+  }
+  seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  volatile size_t keep = layers;
+  (void)keep;
+  return static_cast<double>(delivered) / seconds;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+  ParseMode mode = ParseMode::Eager;
+  std::vector<Packet> corpus;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--threads" && i + 1 < argc) {
+      max_threads = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "--mode" && i + 1 < argc) {
+      mode = std::string(argv[++i]) == "lazy" ? ParseMode::Lazy : ParseMode::Eager;
+    } else if (!readPcap(arg, corpus)) {
+      std::cerr << "Not a pcap file: " << arg << std::endl;
+      return 1;
+    }
+  }
+  if (corpus.empty()) {
+    CorpusBuilder builder(12345);
+    for (int i = 0; i < 20000; i++) {
+      corpus.push_back(builder.next());
+    }
+  }
+
+  std::vector<PacketView> views(corpus.size());
+  for (size_t i = 0; i < corpus.size(); i++) {
+    views[i].data = corpus[i].data();
+    views[i].length = corpus[i].size();
+    views[i].original_length = corpus[i].size();
+  }
+
+  std::string tests_dir = std::string(__FILE__).substr(0, std::string(__FILE__).find_last_of("/\\"));
+  PacketParser parser;
+  parser.setProtocolEntryFile(tests_dir + "/../../core-node/assets/protocols/ethernet.json");
+
+  std::cout << corpus.size() << " packets replayed, " << (mode == ParseMode::Lazy ? "lazy" : "eager")
+            << " parsing, " << std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+  std::cout << "threads  Mpackets/s  speedup  efficiency" << std::endl;
+  std::cout << std::fixed << std::setprecision(2);
+
+  double single = 0;
+  for (size_t threads = 1; threads <= max_threads; threads++) {
+    double packets_per_second = replay(parser, threads, mode, views);
+    if (threads == 1) {
+      single = packets_per_second;
+    }
+    double speedup = packets_per_second / single;
+    std::cout << std::setw(7) << threads << std::setw(12) << packets_per_second / 1e6 << std::setw(9) << speedup
+              << std::setw(11) << 100 * speedup / static_cast<double>(threads) << "%" << std::endl;
+  }
+  return 0;
+}
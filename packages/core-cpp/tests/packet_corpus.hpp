@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Packets for the parser tests and benchmarks: a synthetic corpus, or frames replayed from pcap files
+
+using Packet = std::vector<uint8_t>;
+
+class CorpusBuilder {
+public:
+  explicit CorpusBuilder(uint32_t seed) : rng_(seed) {}
+
+  Packet next() {
+    Packet packet;
+    random(packet, 12);
+    static const uint16_t ether_types[] = {0x0800, 0x86DD, 0x0806, 0x8100, 0x8847, 0x88CC, 0x1234};
+    uint16_t ether_type = ether_types[pick(7)];
+    put16(packet, ether_type);
+
+    if (ether_type == 0x8100) {
+      random(packet, 2);
+      static const uint16_t inner_types[] = {0x0800, 0x86DD, 0x0806, 0x4444};
+      ether_type = inner_types[pick(4)];
+      put16(packet, ether_type);
+    }
+
+    if (ether_type == 0x8847) {
+      uint32_t labels = 1 + pick(3);
+      for (uint32_t label = 0; label < labels; label++) {
+        random(packet, 2);
+        packet.push_back(static_cast<uint8_t>(pick(8) << 1 | (label == labels - 1)));
+        packet.push_back(static_cast<uint8_t>(pick(256)));
+      }
+      ip(packet, pick(2) == 1);
+    } else if (ether_type == 0x0800 || ether_type == 0x86DD) {
+      ip(packet, ether_type == 0x86DD);
+    } else {
+      random(packet, 28 + pick(40));
+    }
+
+    if (pick(5) == 0) {
+      packet.resize(1 + pick(static_cast<uint32_t>(packet.size())));
+    }
+    return packet;
+  }
+
+private:
+  std::mt19937 rng_;
+
+  uint32_t pick(uint32_t n) { return rng_() % n; }
+
+  void put16(Packet& packet, uint16_t value) {
+    packet.push_back(static_cast<uint8_t>(value >> 8));
+    packet.push_back(static_cast<uint8_t>(value));
+  }
+
+  void random(Packet& packet, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+      packet.push_back(static_cast<uint8_t>(rng_()));
+    }
+  }
+
+  void ip(Packet& packet, bool v6) {
+    static const uint8_t protocols[] = {1, 6, 17, 58, 99};
+    uint8_t protocol = protocols[pick(5)];
+    if (v6) {
+      packet.push_back(0x60);
+      random(packet, 5);
+      packet.push_back(protocol);
+      random(packet, 33);
+    } else {
+      uint8_t ihl = static_cast<uint8_t>(5 + pick(11));
+      packet.push_back(0x40 | ihl);
+      random(packet, 8);
+      packet.push_back(protocol);
+      random(packet, 10 + (ihl - 5) * 4);
+    }
+
+    static const uint16_t ports[] = {53, 80, 443, 67, 68, 1234};
+    if (protocol == 6 || protocol == 17) {
+      put16(packet, ports[pick(6)]);
+      put16(packet, ports[pick(6)]);
+    }
+    random(packet, 20 + pick(64));
+  }
+};
+
+// Classic pcap, either byte order, microsecond or nanosecond timestamps
+inline bool readPcap(const std::string& path, std::vector<Packet>& corpus) {
+  std::ifstream file(path, std::ios::binary);
+  uint8_t header[24];
+  if (!file.read(reinterpret_cast<char*>(header), sizeof(header))) {
+    return false;
+  }
+
+  uint32_t magic = header[0] | header[1] << 8 | header[2] << 16 | static_cast<uint32_t>(header[3]) << 24;
+  bool swapped = magic == 0xD4C3B2A1 || magic == 0x4D3CB2A1;
+  if (!swapped && magic != 0xA1B2C3D4 && magic != 0xA1B23C4D) {
+    return false;
+  }
+  auto read32 = [swapped](const uint8_t* p) {
+    if (swapped) {
+      return static_cast<uint32_t>(p[0]) << 24 | p[1] << 16 | p[2] << 8 | p[3];
+    }
+    return p[0] | p[1] << 8 | p[2] << 16 | static_cast<uint32_t>(p[3]) << 24;
+  };
+
+  uint8_t record[16];
+  while (file.read(reinterpret_cast<char*>(record), sizeof(record))) {
+    Packet packet(read32(record + 8));
+    if (!file.read(reinterpret_cast<char*>(packet.data()), packet.size())) {
+      break;
+    }
+    corpus.push_back(std::move(packet));
+  }
+  return true;
+}
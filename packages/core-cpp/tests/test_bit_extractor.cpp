@@ -0,0 +1,84 @@
+#include "../src/cpp/parser/bit_extractor.hpp"
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+
+// Every offset within a byte and every length must read the same value as extractBits()
+bool checkAgainstGeneric(const std::vector<uint8_t>& data) {
+  for (uint32_t offset = 0; offset < 64; offset++) {
+    for (uint32_t length = 0; length <= 65; length++) {
+      BitExtractor extractor = BitExtractor::select(offset, length);
+      uint64_t expected = extractBits(data.data(), data.size(), offset, length);
+      uint64_t actual = extractor.extract(data.data());
+      if (expected != actual) {
+        std::cerr << "Mismatch at offset " << offset << " length " << length << ": " << actual << " != " << expected
+                  << std::endl;
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+template <typename Extract> double nanosecondsPerField(size_t iterations, size_t fields, Extract extract) {
+  uint64_t sink = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < iterations; i++) {
+    sink += extract(i);
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  volatile uint64_t keep = sink;
+  (void)keep;
+  return std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(iterations * fields);
+}
+
+} // namespace
+
+int main() {
+  std::mt19937 rng(42);
+  std::vector<uint8_t> data(256);
+  for (uint8_t& byte : data) {
+    byte = static_cast<uint8_t>(rng());
+  }
+
+  if (!checkAgainstGeneric(data)) {
+    return 1;
+  }
+
+  // Ethernet, IPv4 and TCP header fields, as the protocol files define them
+  const std::vector<std::pair<uint32_t, uint32_t>> fields = {
+      {0, 48},     {48, 48},    {96, 16},    {112, 4},    {116, 4},    {120, 6},    {126, 2},    {128, 16},
+      {144, 16},   {160, 3},    {163, 13},   {176, 8},    {184, 8},    {192, 16},   {208, 32},   {240, 32},
+      {272, 16},   {288, 16},   {304, 32},   {336, 32},   {368, 4},    {372, 3},    {375, 9},    {384, 16},
+      {400, 16},   {416, 16}};
+  std::vector<BitExtractor> extractors;
+  for (const auto& [offset, length] : fields) {
+    extractors.push_back(BitExtractor::select(offset, length));
+  }
+
+  const size_t iterations = 2000000;
+  double generic = nanosecondsPerField(iterations, fields.size(), [&](size_t i) {
+    const uint8_t* packet = data.data() + (i & 63);
+    uint64_t sum = 0;
+    for (const auto& [offset, length] : fields) {
+      sum += extractBits(packet, 128, offset, length);
+    }
+    return sum;
+  });
+  double fast = nanosecondsPerField(iterations, fields.size(), [&](size_t i) {
+    const uint8_t* packet = data.data() + (i & 63);
+    uint64_t sum = 0;
+    for (const BitExtractor& extractor : extractors) {
+      sum += extractor.extract(packet);
+    }
+    return sum;
+  });
+
+  std::cout << "extractBits:  " << generic << " ns/field" << std::endl;
+  std::cout << "BitExtractor: " << fast << " ns/field (" << generic / fast << "x)" << std::endl;
+  return 0;
+}
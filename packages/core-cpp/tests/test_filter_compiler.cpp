@@ -0,0 +1,225 @@
+#include "../src/cpp/sniffer/filter_compiler.hpp"
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// FilterCompiler programs run through a classic BPF interpreter on hand-built frames, plus expressions it must
+// refuse.
+
+namespace {
+
+using Packet = std::vector<uint8_t>;
+
+// The subset of classic BPF the compiler emits; like the kernel, a load past the end rejects the frame
+uint32_t runFilter(const std::vector<struct sock_filter>& program, const Packet& packet) {
+  uint32_t a = 0;
+  uint32_t x = 0;
+
+  auto load = [&packet](uint32_t offset, uint32_t size, uint32_t& value) {
+    if (offset + size > packet.size()) {
+      return false;
+    }
+    value = 0;
+    for (uint32_t i = 0; i < size; i++) {
+      value = value << 8 | packet[offset + i];
+    }
+    return true;
+  };
+
+  for (size_t pc = 0; pc < program.size(); pc++) {
+    const struct sock_filter& insn = program[pc];
+    uint32_t size = BPF_SIZE(insn.code) == BPF_B ? 1 : BPF_SIZE(insn.code) == BPF_H ? 2 : 4;
+
+    switch (BPF_CLASS(insn.code)) {
+    case BPF_LD:
+      if (!load(BPF_MODE(insn.code) == BPF_IND ? x + insn.k : insn.k, size, a)) {
+        return 0;
+      }
+      break;
+    case BPF_LDX:
+      if (!load(insn.k, 1, x)) {
+        return 0;
+      }
+      x = 4 * (x & 0xf);
+      break;
+    case BPF_ALU:
+      if (BPF_OP(insn.code) == BPF_AND) {
+        a &= insn.k;
+      } else if (BPF_OP(insn.code) == BPF_RSH) {
+        a >>= insn.k;
+      } else {
+        throw std::runtime_error("Unexpected ALU instruction");
+      }
+      break;
+    case BPF_JMP:
+      if (BPF_OP(insn.code) == BPF_JA) {
+        pc += insn.k;
+      } else if (BPF_OP(insn.code) == BPF_JEQ) {
+        pc += a == insn.k ? insn.jt : insn.jf;
+      } else {
+        throw std::runtime_error("Unexpected jump instruction");
+      }
+      break;
+    case BPF_RET:
+      return insn.k;
+    default:
+      throw std::runtime_error("Unexpected instruction class");
+    }
+  }
+  throw std::runtime_error("Program runs past its end");
+}
+
+void put16(Packet& packet, uint16_t value) {
+  packet.push_back(static_cast<uint8_t>(value >> 8));
+  packet.push_back(static_cast<uint8_t>(value));
+}
+
+void put32(Packet& packet, uint32_t value) {
+  put16(packet, static_cast<uint16_t>(value >> 16));
+  put16(packet, static_cast<uint16_t>(value));
+}
+
+Packet ethernet(uint16_t ether_type, uint8_t source_last = 1) {
+  Packet packet = {0x02, 0, 0, 0, 0, 0x02, 0x02, 0, 0, 0, 0, source_last};
+  put16(packet, ether_type);
+  return packet;
+}
+
+// IPv4 with ihl 32-bit words of header, fragment_offset in 8-byte units
+Packet ipv4(uint8_t protocol, uint32_t source, uint32_t destination, uint16_t fragment_offset = 0, uint8_t ihl = 5) {
+  Packet packet = ethernet(0x0800);
+  packet.push_back(static_cast<uint8_t>(0x40 | ihl));
+  packet.push_back(0);
+  put16(packet, 0);
+  put16(packet, 0x1234);
+  put16(packet, fragment_offset);
+  packet.push_back(64);
+  packet.push_back(protocol);
+  put16(packet, 0);
+  put32(packet, source);
+  put32(packet, destination);
+  packet.resize(packet.size() + (ihl - 5) * 4);
+  return packet;
+}
+
+Packet ipv6(uint8_t next_header) {
+  Packet packet = ethernet(0x86DD);
+  put32(packet, 0x60000000);
+  put16(packet, 0);
+  packet.push_back(next_header);
+  packet.push_back(64);
+  for (int i = 0; i < 16; i++) {
+    packet.push_back(i == 0 ? 0xfd : i == 15 ? 1 : 0);
+  }
+  for (int i = 0; i < 16; i++) {
+    packet.push_back(i == 0 ? 0xfd : i == 15 ? 2 : 0);
+  }
+  return packet;
+}
+
+// Source and destination port, then enough bytes for either header
+Packet ports(Packet packet, uint16_t source, uint16_t destination) {
+  put16(packet, source);
+  put16(packet, destination);
+  packet.resize(packet.size() + 28);
+  return packet;
+}
+
+constexpr uint32_t HOST_A = 0x0a000001; // 10.0.0.1
+constexpr uint32_t HOST_B = 0xc0a80102; // 192.168.1.2
+
+struct Case {
+  const char* expression;
+  Packet packet;
+  bool accepted;
+};
+
+} // namespace
+
+int main() {
+  std::string tests_dir = std::string(__FILE__).substr(0, std::string(__FILE__).find_last_of("/\\"));
+  FilterCompiler compiler(tests_dir + "/../../core-node/assets/protocols/ethernet.json");
+
+  Packet dns_query = ports(ipv4(17, HOST_A, HOST_B), 40000, 53);
+  Packet udp_http = ports(ipv4(17, HOST_A, HOST_B), 40000, 80);
+  Packet tcp_http = ports(ipv4(6, HOST_B, HOST_A), 80, 40000);
+  // A later fragment: the bytes where UDP ports would be are payload, and read as port 53
+  Packet udp_fragment = ports(ipv4(17, HOST_A, HOST_B, 185), 40000, 53);
+  Packet options_dns = ports(ipv4(17, HOST_A, HOST_B, 0, 7), 40000, 53);
+  Packet v6_dns = ports(ipv6(17), 40000, 53);
+  Packet arp = ethernet(0x0806, 9);
+  arp.resize(42);
+
+  const std::vector<Case> cases = {
+      {"udp", dns_query, true},
+      {"udp", tcp_http, false},
+      {"udp", udp_fragment, true},
+      {"dns", dns_query, true},
+      {"dns", udp_http, false},
+      {"dns", udp_fragment, false},
+      {"dns", options_dns, true},
+      {"dns", v6_dns, true},
+      {"ip and dns", v6_dns, false},
+      {"ip6 and udp", v6_dns, true},
+      {"port 80", udp_http, true},
+      {"port 80", tcp_http, true},
+      {"tcp port 80", udp_http, false},
+      {"tcp src port 80", tcp_http, true},
+      {"tcp dst port 80", tcp_http, false},
+      {"dst port 53", options_dns, true},
+      {"dst port 53", udp_fragment, false},
+      {"host 10.0.0.1", dns_query, true},
+      {"host 10.0.0.1", tcp_http, true},
+      {"src host 10.0.0.1", tcp_http, false},
+      {"dst host 10.0.0.1", tcp_http, true},
+      {"net 192.168.0.0/16", dns_query, true},
+      {"src net 192.168.0.0/16", dns_query, false},
+      {"host fd00::2", v6_dns, true},
+      {"net fd00::/8", v6_dns, true},
+      {"ether src 02:00:00:00:00:09", arp, true},
+      {"ether src 02:00:00:00:00:09", dns_query, false},
+      {"arp", arp, true},
+      {"not dns", dns_query, false},
+      {"not dns", tcp_http, true},
+      {"udp and not port 53", udp_http, true},
+      {"(tcp || udp) && dst port 53", dns_query, true},
+      {"(tcp || udp) && dst port 53", tcp_http, false},
+      {"dhcp or dns", dns_query, true},
+      {"dns", Packet(dns_query.begin(), dns_query.begin() + 30), false},
+  };
+
+  int failures = 0;
+  for (const Case& test : cases) {
+    std::vector<struct sock_filter> program = compiler.compile(test.expression);
+    bool accepted = runFilter(program, test.packet) == FILTER_ACCEPT_LENGTH;
+    if (accepted != test.accepted) {
+      std::cerr << "'" << test.expression << "' " << (accepted ? "accepts" : "rejects") << " a "
+                << test.packet.size() << "-byte frame" << std::endl;
+      failures++;
+    }
+  }
+
+  if (runFilter(compiler.compile("dns", 96), dns_query) != 96) {
+    std::cerr << "Accept length is not the one requested" << std::endl;
+    failures++;
+  }
+
+  for (const char* invalid :
+       {"udp port", "bogus", "host 300.1.1.1", "net 10.0.0.0/40", "(udp", "udp)", "host 10.0.0.0/8", "port 70000",
+        "ether host 02:00:00"}) {
+    try {
+      compiler.compile(invalid);
+      std::cerr << "'" << invalid << "' compiled" << std::endl;
+      failures++;
+    } catch (const std::runtime_error&) {
+    }
+  }
+
+  if (failures > 0) {
+    return 1;
+  }
+  std::cout << cases.size() << " filter cases passed" << std::endl;
+  return 0;
+}
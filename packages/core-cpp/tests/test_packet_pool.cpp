@@ -0,0 +1,201 @@
+#include "../src/cpp/utils/buffer/packet_pool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// PacketPool and PacketRef: size classes, sharing and copying packets, handle copy/move/reset semantics, and a
+// steady-state workload released on another thread that must neither leak buffers nor keep adding slabs.
+
+namespace {
+
+int failures = 0;
+
+void expect(bool condition, const std::string& what) {
+  if (!condition) {
+    std::cerr << what << std::endl;
+    failures++;
+  }
+}
+
+void testAcquire() {
+  PacketPool pool;
+  expect(pool.getSlabCount() == 0 && pool.getBuffersInUse() == 0, "New pool not empty");
+
+  // Smallest class holding the length, lengths above MAX_PACKET_SIZE clamped to it
+  const std::pair<size_t, size_t> sizes[] = {{0, 256}, {60, 256}, {256, 256}, {257, 2048}, {1500, 2048},
+                                             {2049, MAX_PACKET_SIZE}, {MAX_PACKET_SIZE + 1, MAX_PACKET_SIZE}};
+  std::vector<PacketRef> refs;
+  for (const auto& [length, capacity] : sizes) {
+    PacketRef ref = pool.acquire(length);
+    expect(ref && ref->capacity() == capacity && ref->length == std::min(length, MAX_PACKET_SIZE),
+           "acquire(" + std::to_string(length) + ") picked the wrong buffer");
+    refs.push_back(std::move(ref));
+  }
+  expect(pool.getBuffersInUse() == std::size(sizes), "Buffers in use miscounted");
+  expect(pool.getSlabCount() == PACKET_POOL_SIZE_CLASSES.size(), "One slab per size class expected");
+
+  // Freed buffers are reused before anything new is carved
+  PacketBuffer* last = refs.back().get();
+  refs.clear();
+  expect(pool.getBuffersInUse() == 0, "Buffers still in use after release");
+  expect(pool.acquire(MAX_PACKET_SIZE).get() == last, "Released buffer not reused");
+}
+
+void testShare() {
+  PacketPool pool;
+  std::vector<uint8_t> bytes(1000);
+  for (size_t i = 0; i < bytes.size(); i++) {
+    bytes[i] = static_cast<uint8_t>(i * 13);
+  }
+  PacketView view;
+  view.data = bytes.data();
+  view.length = bytes.size();
+  view.original_length = 1514;
+  view.interface_index = 3;
+  view.timestamp = PacketTimestamp(std::chrono::nanoseconds(123456789));
+
+  // A view without a buffer is copied, bytes and metadata
+  PacketRef copy = pool.share(view);
+  PacketView copied = copy.view();
+  expect(copied.data != bytes.data() && copied.length == view.length &&
+             std::memcmp(copied.data, bytes.data(), bytes.size()) == 0,
+         "share() copied the wrong bytes");
+  expect(copied.original_length == 1514 && copied.interface_index == 3 && copied.timestamp == view.timestamp &&
+             copied.buffer == copy.get(),
+         "share() lost the metadata");
+  bytes[0] ^= 0xff;
+  expect(copied.data[0] != bytes[0], "share() copy aliases the source");
+
+  // A view of a pooled buffer shares it
+  PacketRef shared = pool.share(copied);
+  expect(shared.get() == copy.get() && pool.getBuffersInUse() == 1, "share() copied a pooled buffer");
+
+  // An empty view still yields a buffer, of length 0
+  PacketRef empty = pool.share(PacketView());
+  expect(empty && empty->length == 0 && pool.getBuffersInUse() == 2, "share() of an empty view");
+}
+
+void testHandles() {
+  PacketPool pool;
+  PacketRef first = pool.acquire(100);
+  PacketBuffer* buffer = first.get();
+
+  // Copies share the buffer, it only returns to the pool with the last one
+  PacketRef second(first);
+  PacketRef third;
+  third = second;
+  expect(second.get() == buffer && third.get() == buffer && pool.getBuffersInUse() == 1, "Copy took a new buffer");
+  first.reset();
+  second.reset();
+  expect(!first && !second && pool.getBuffersInUse() == 1, "Buffer released while still referenced");
+
+  // Moves leave the source empty and the count alone
+  PacketRef moved(std::move(third));
+  expect(!third && moved.get() == buffer && pool.getBuffersInUse() == 1, "Move constructor");
+  PacketRef assigned;
+  assigned = std::move(moved);
+  expect(!moved && assigned.get() == buffer && pool.getBuffersInUse() == 1, "Move assignment");
+
+  // Assigning over a handle releases what it held
+  assigned = pool.acquire(100);
+  expect(assigned.get() != buffer && pool.getBuffersInUse() == 1, "Assignment leaked the previous buffer");
+  assigned = PacketRef();
+  expect(!assigned && pool.getBuffersInUse() == 0, "Assigning an empty handle kept the buffer");
+
+  // Resetting an empty handle and viewing it are harmless
+  assigned.reset();
+  expect(assigned.view().data == nullptr && assigned.view().buffer == nullptr, "Empty handle has a view");
+  expect(pool.getBuffersInUse() == 0, "Reset of an empty handle released something");
+}
+
+// Taken on this thread, held by a copy while queued, released on another as the JS thread would
+void testSteadyState() {
+  PacketPool pool;
+  std::mutex mutex;
+  std::condition_variable ready;
+  std::deque<PacketRef> queue;
+  bool done = false;
+
+  std::thread releaser([&] {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      ready.wait(lock, [&] { return done || !queue.empty(); });
+      if (queue.empty()) {
+        break;
+      }
+      PacketRef ref = std::move(queue.front());
+      queue.pop_front();
+      lock.unlock();
+      ref.reset();
+      lock.lock();
+    }
+  });
+
+  size_t slabs_after_warmup = 0;
+  std::vector<uint8_t> bytes(MAX_PACKET_SIZE, 0xab);
+  for (int round = 0; round < 50; round++) {
+    std::vector<PacketRef> batch;
+    for (size_t i = 0; i < 600; i++) {
+      PacketView view;
+      view.data = bytes.data();
+      view.length = (i * 97) % (MAX_PACKET_SIZE + 100);
+      batch.push_back(pool.share(view));
+      if (i % 3 == 0) {
+        batch.push_back(pool.share(batch.back().view()));
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      for (PacketRef& ref : batch) {
+        queue.push_back(std::move(ref));
+      }
+    }
+    ready.notify_one();
+
+    // Wait for the other thread to hand everything back before the next round
+    while (pool.getBuffersInUse() != 0) {
+      std::this_thread::yield();
+    }
+
+    if (round == 0) {
+      slabs_after_warmup = pool.getSlabCount();
+    } else if (pool.getSlabCount() != slabs_after_warmup) {
+      std::cerr << "Slabs grew from " << slabs_after_warmup << " to " << pool.getSlabCount() << " in round " << round
+                << std::endl;
+      failures++;
+      break;
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    done = true;
+  }
+  ready.notify_one();
+  releaser.join();
+  expect(pool.getBuffersInUse() == 0, "Buffers leaked in steady state");
+}
+
+} // namespace
+
+int main() {
+  testAcquire();
+  testShare();
+  testHandles();
+  testSteadyState();
+
+  if (failures > 0) {
+    return 1;
+  }
+  std::cout << "Packet pool tests passed" << std::endl;
+  return 0;
+}
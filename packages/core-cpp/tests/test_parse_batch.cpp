@@ -0,0 +1,189 @@
+#include "../src/cpp/parser/generated_parser.hpp"
+#include "../src/cpp/parser/packet_parser.hpp"
+#include "./packet_corpus.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+
+// parseBatch(), the generated parser and lazy decoding against parsePacket() on a synthetic
+// Ethernet/VLAN/MPLS/IPv4/IPv6/ARP corpus, with random truncation, plus any classic pcap files given as arguments.
+
+namespace {
+
+bool samePacket(const ParsedPacket& expected, const ParsedPacket& actual) {
+  if (expected.layers.size() != actual.layers.size() || expected.values != actual.values) {
+    return false;
+  }
+  for (size_t l = 0; l < expected.layers.size(); l++) {
+    const ParsedLayer& a = expected.layers[l];
+    const ParsedLayer& b = actual.layers[l];
+    if (a.protocol_id != b.protocol_id || a.bit_offset != b.bit_offset || a.first_value != b.first_value) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// parseChain(), then each layer decoded on demand from the last one down, against parsePacket() field for field
+bool checkLazy(ParserModel& parser, const char* name, const std::vector<PacketView>& views) {
+  ParsedPacket eager;
+  ParsedPacket lazy;
+  for (size_t i = 0; i < views.size(); i++) {
+    parser.parsePacket(views[i], eager);
+    parser.parseChain(views[i], lazy);
+
+    bool same_chain = eager.layers.size() == lazy.layers.size() && eager.values.size() == lazy.values.size();
+    for (size_t l = 0; same_chain && l < eager.layers.size(); l++) {
+      same_chain = eager.layers[l].protocol_id == lazy.layers[l].protocol_id &&
+                   eager.layers[l].bit_offset == lazy.layers[l].bit_offset &&
+                   eager.layers[l].first_value == lazy.layers[l].first_value;
+    }
+    if (!same_chain) {
+      std::cerr << name << ": parseChain() differs from parsePacket() on the layers of packet " << i << std::endl;
+      return false;
+    }
+
+    for (size_t l = lazy.layers.size(); l-- > 0;) {
+      lazy.decodeLayer(l, views[i]);
+      size_t end = l + 1 < lazy.layers.size() ? lazy.layers[l + 1].first_value : lazy.values.size();
+      for (size_t v = lazy.layers[l].first_value; v < end; v++) {
+        if (!lazy.isDecoded(l) || lazy.values[v] != eager.values[v]) {
+          std::cerr << name << ": lazily decoded " << lazy.protocol(l).name << " field "
+                    << v - lazy.layers[l].first_value << " differs on " << views[i].length << "-byte packet " << i
+                    << std::endl;
+          return false;
+        }
+      }
+    }
+    if (lazy.pending_layers != 0 || !samePacket(eager, lazy)) {
+      std::cerr << name << ": packet " << i << " differs once every layer is decoded" << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+// Selected kernel against the scalar one and BitExtractor on random layers and plans of every size
+bool checkKernel() {
+  std::mt19937 rng(7);
+  std::vector<uint8_t> data(4096);
+  for (uint8_t& byte : data) {
+    byte = static_cast<uint8_t>(rng());
+  }
+
+  FieldGatherKernel kernel = selectFieldGatherKernel();
+  for (int round = 0; round < 2000; round++) {
+    std::vector<BitExtractor> extractors(rng() % 24);
+    FieldGatherPlan plan;
+    for (BitExtractor& extractor : extractors) {
+      extractor = BitExtractor::select(rng() % 512, 1 + rng() % 64);
+      plan.add(extractor);
+    }
+
+    const uint8_t* layer = data.data() + rng() % (data.size() - plan.extent_bytes);
+    std::vector<uint64_t> expected(plan.size());
+    std::vector<uint64_t> actual(plan.size());
+    gatherFieldsScalar(layer, plan, expected.data());
+    kernel(layer, plan, actual.data());
+
+    for (size_t j = 0; j < plan.size(); j++) {
+      bool generic = extractors[j].getKind() == BitExtractor::Kind::Generic;
+      if (expected[j] != actual[j] || (!generic && actual[j] != extractors[j].extract(layer))) {
+        std::cerr << getFieldGatherKernelName() << " kernel mismatch on field " << j << " of round " << round
+                  << std::endl;
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  std::cout << "Field gather kernel: " << getFieldGatherKernelName() << std::endl;
+  if (!checkKernel()) {
+    return 1;
+  }
+
+  std::string tests_dir = std::string(__FILE__).substr(0, std::string(__FILE__).find_last_of("/\\"));
+  PacketParser parser;
+  parser.setProtocolEntryFile(tests_dir + "/../../core-node/assets/protocols/ethernet.json");
+
+  std::vector<Packet> corpus;
+  CorpusBuilder builder(12345);
+  for (int i = 0; i < 20000; i++) {
+    corpus.push_back(builder.next());
+  }
+  corpus.emplace_back(); // Empty packet
+  for (int i = 1; i < argc; i++) {
+    if (!readPcap(argv[i], corpus)) {
+      std::cerr << "Not a pcap file: " << argv[i] << std::endl;
+      return 1;
+    }
+  }
+
+  std::vector<PacketView> views(corpus.size());
+  for (size_t i = 0; i < corpus.size(); i++) {
+    views[i].data = corpus[i].data();
+    views[i].length = corpus[i].size();
+  }
+
+  // Every truncation of a few packets four or more layers deep, for the lazy check: cuts inside the field a
+  // selector reads, inside other fields and right at layer boundaries
+  std::vector<PacketView> truncated = views;
+  ParsedPacket deep;
+  for (size_t i = 0, found = 0; i < views.size() && found < 20; i++) {
+    parser.parsePacket(views[i], deep);
+    if (deep.layers.size() >= 4) {
+      for (size_t length = 1; length < views[i].length; length++) {
+        truncated.push_back(views[i]);
+        truncated.back().length = length;
+      }
+      found++;
+    }
+  }
+
+  // Batches of every size up to two chunks, so partial kernel groups and chunk boundaries are covered
+  std::vector<ParsedPacket> batch(2 * PROCESSING_BATCH_SIZE + 1);
+  ParsedPacket single;
+  size_t layers = 0;
+  size_t batch_size = 1;
+  for (size_t start = 0; start < views.size(); start += batch_size, batch_size = batch_size % batch.size() + 1) {
+    size_t count = std::min(batch_size, views.size() - start);
+    parser.parseBatch(views.data() + start, batch.data(), count);
+    for (size_t i = 0; i < count; i++) {
+      parser.parsePacket(views[start + i], single);
+      if (!samePacket(single, batch[i])) {
+        std::cerr << "parseBatch differs from parsePacket on packet " << start + i << std::endl;
+        return 1;
+      }
+      layers += single.layers.size();
+    }
+  }
+
+  // Generated from the same protocol files at build time, so it must not fall back to interpreting them
+  GeneratedParser generated;
+  generated.setProtocolEntryFile(parser.getProtocolEntryFile());
+  if (!generated.isGenerated()) {
+    std::cerr << "Generated parser does not match the bundled protocol files" << std::endl;
+    return 1;
+  }
+  if (!checkLazy(parser, "Interpreted", truncated) || !checkLazy(generated, "Generated", truncated)) {
+    return 1;
+  }
+
+  ParsedPacket generated_packet;
+  for (size_t i = 0; i < views.size(); i++) {
+    parser.parsePacket(views[i], single);
+    generated.parsePacket(views[i], generated_packet);
+    if (!samePacket(single, generated_packet)) {
+      std::cerr << "Generated parser differs from parsePacket on packet " << i << std::endl;
+      return 1;
+    }
+  }
+
+  std::cout << corpus.size() << " packets, " << layers << " layers identical, lazily decoded as well on "
+            << truncated.size() - views.size() << " more truncations" << std::endl;
+  return 0;
+}
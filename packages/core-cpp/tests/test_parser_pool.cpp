@@ -0,0 +1,200 @@
+#include "../src/cpp/sniffer/parser_pool.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ParserPool with more threads than the machine may have cores and batches of very uneven cost: the sink must see
+// every batch in submission order, and a parser swapped in with setParser() must parse exactly the batches
+// claimed after the call.
+
+namespace {
+
+constexpr uint32_t BATCHES = 400;
+
+// Records its tag and the packet's sequence number as the packet's only values. Packets whose second byte is
+// set sleep that many tens of microseconds, so batches finish out of order.
+class TaggedParser : public ParserModel {
+public:
+  explicit TaggedParser(uint64_t tag) : tag_(tag) {}
+
+  void parsePacket(const PacketView& packet, ParsedPacket& out) override {
+    out.clear();
+    uint32_t sequence = 0;
+    std::memcpy(&sequence, packet.data + 4, sizeof(sequence));
+    if (packet.data[1] != 0) {
+      std::this_thread::sleep_for(std::chrono::microseconds(10 * packet.data[1]));
+    }
+    out.values = {tag_, sequence};
+  }
+
+  void setProtocolEntryFile(const std::string& path) override { path_ = path; }
+  const std::string& getProtocolEntryFile() const override { return path_; }
+  std::unique_ptr<ParserModel> clone() const override { return std::make_unique<TaggedParser>(tag_); }
+
+private:
+  uint64_t tag_;
+  std::string path_;
+};
+
+struct Delivered {
+  uint32_t sequence;
+  uint64_t tag;
+};
+
+class Harness {
+public:
+  explicit Harness(size_t thread_count) : pool_(TaggedParser(1), thread_count, ParseMode::Eager) {}
+
+  // Submits batch number batch, waiting for the oldest one first when every slot is taken
+  void submit(uint32_t batch) {
+    while (pool_.isFull()) {
+      pool_.deliver(sink(), true);
+    }
+
+    // Sizes from 1 to PROCESSING_BATCH_SIZE, one batch in three slow
+    size_t count = 1 + (batch * 7) % PROCESSING_BATCH_SIZE;
+    uint8_t cost = batch % 3 == 0 ? static_cast<uint8_t>(1 + batch % 50) : 0;
+    std::vector<std::vector<uint8_t>> frames(count, std::vector<uint8_t>(60));
+    std::vector<PacketView> views(count);
+    for (size_t i = 0; i < count; i++) {
+      frames[i][1] = cost;
+      uint32_t sequence = next_sequence_++;
+      std::memcpy(frames[i].data() + 4, &sequence, sizeof(sequence));
+      views[i].data = frames[i].data();
+      views[i].length = frames[i].size();
+      views[i].original_length = frames[i].size();
+    }
+    pool_.submit(views.data(), count);
+  }
+
+  // Whatever is parsed at the head, without waiting
+  void deliverReady() { pool_.deliver(sink(), false); }
+
+  void drain() {
+    while (!pool_.isIdle()) {
+      pool_.deliver(sink(), true);
+    }
+  }
+
+  uint32_t submittedPackets() const { return next_sequence_; }
+  ParserPool& pool() { return pool_; }
+  const std::vector<Delivered>& delivered() const { return delivered_; }
+
+  // Every packet submitted came back once, in order, with the values its parser wrote
+  bool inOrder() const {
+    if (delivered_.size() != next_sequence_) {
+      std::cerr << delivered_.size() << " of " << next_sequence_ << " packets delivered" << std::endl;
+      return false;
+    }
+    for (uint32_t i = 0; i < delivered_.size(); i++) {
+      if (delivered_[i].sequence != i) {
+        std::cerr << "Packet " << delivered_[i].sequence << " delivered in position " << i << std::endl;
+        return false;
+      }
+    }
+    return true;
+  }
+
+private:
+  ParserPool pool_;
+  uint32_t next_sequence_ = 0;
+  std::vector<Delivered> delivered_;
+
+  ParsedBatchSink sink() {
+    return [this](const PacketView* packets, ParsedPacket* parsed, size_t count) {
+      for (size_t i = 0; i < count; i++) {
+        uint32_t sequence = 0;
+        std::memcpy(&sequence, packets[i].data + 4, sizeof(sequence));
+        bool matches = parsed[i].values.size() == 2 && parsed[i].values[1] == sequence;
+        delivered_.push_back({matches ? sequence : UINT32_MAX, matches ? parsed[i].values[0] : 0});
+      }
+    };
+  }
+};
+
+bool testOrder(size_t thread_count) {
+  Harness harness(thread_count);
+  for (uint32_t batch = 0; batch < BATCHES; batch++) {
+    harness.submit(batch);
+    if (batch % 5 == 0) {
+      harness.deliverReady();
+    }
+  }
+  harness.drain();
+  return harness.inOrder();
+}
+
+// Parsers tagged 2 to 5 swapped in while batches are in flight: tags never go back down in delivery order,
+// packets submitted after a swap carry at least its tag, and those delivered before it a lower one
+bool testSetParser(size_t thread_count) {
+  struct Swap {
+    uint64_t tag;
+    size_t delivered_before;
+    uint32_t submitted_before;
+  };
+  Harness harness(thread_count);
+  std::vector<Swap> swaps;
+
+  for (uint32_t batch = 0; batch < BATCHES; batch++) {
+    if (batch % 100 == 50) {
+      uint64_t tag = 2 + batch / 100;
+      swaps.push_back({tag, harness.delivered().size(), harness.submittedPackets()});
+      harness.pool().setParser(TaggedParser(tag));
+    }
+    harness.submit(batch);
+    if (batch % 5 == 0) {
+      harness.deliverReady();
+    }
+  }
+  harness.drain();
+  if (!harness.inOrder()) {
+    return false;
+  }
+
+  const std::vector<Delivered>& delivered = harness.delivered();
+  for (const Swap& swap : swaps) {
+    for (size_t i = 0; i < delivered.size(); i++) {
+      bool before = i < swap.delivered_before && delivered[i].tag >= swap.tag;
+      bool after = i >= swap.submitted_before && delivered[i].tag < swap.tag;
+      if (before || after) {
+        std::cerr << "Packet " << i << " parsed with tag " << delivered[i].tag << " across setParser(" << swap.tag
+                  << ")" << std::endl;
+        return false;
+      }
+    }
+  }
+  for (size_t i = 1; i < delivered.size(); i++) {
+    if (delivered[i].tag < delivered[i - 1].tag) {
+      std::cerr << "Packet " << i << " parsed with tag " << delivered[i].tag << " after tag " << delivered[i - 1].tag
+                << std::endl;
+      return false;
+    }
+  }
+  return delivered.back().tag == 5;
+}
+
+} // namespace
+
+int main() {
+  int failures = 0;
+  for (size_t thread_count : {1, 3, 8}) {
+    if (!testOrder(thread_count)) {
+      std::cerr << "Out of order with " << thread_count << " threads" << std::endl;
+      failures++;
+    }
+    if (!testSetParser(thread_count)) {
+      std::cerr << "setParser() misapplied with " << thread_count << " threads" << std::endl;
+      failures++;
+    }
+  }
+
+  if (failures > 0) {
+    return 1;
+  }
+  std::cout << "Parser pool tests passed" << std::endl;
+  return 0;
+}
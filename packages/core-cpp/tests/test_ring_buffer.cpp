@@ -0,0 +1,362 @@
+#include "../src/cpp/utils/buffer/ring_buffer.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// RingBuffer on its own: records wrapping around the buffer end, each overflow policy and its counter, batched
+// and in-place access, reserve(), the parked consumer's wake-up, then a producer and a consumer thread racing
+// under each policy.
+
+namespace {
+
+using namespace std::chrono_literals;
+
+// Record sizes that leave every kind of tail before the wrap, up to one truncated to MAX_PACKET_SIZE
+constexpr size_t LENGTHS[] = {4, 60, 61, 1500, 333, MAX_PACKET_SIZE, 9001, 7};
+
+int failures = 0;
+
+void expect(bool condition, const std::string& what) {
+  if (!condition) {
+    std::cerr << what << std::endl;
+    failures++;
+  }
+}
+
+// Frame number sequence, its first four bytes carry the sequence and every field is derived from it
+struct TestFrame {
+  std::vector<uint8_t> bytes;
+  PacketView view;
+
+  explicit TestFrame(uint32_t sequence, size_t length = 0) {
+    bytes.resize(length == 0 ? LENGTHS[sequence % std::size(LENGTHS)] : length);
+    for (size_t i = 0; i < bytes.size(); i++) {
+      bytes[i] = static_cast<uint8_t>(sequence * 31 + i);
+    }
+    std::memcpy(bytes.data(), &sequence, sizeof(sequence));
+    view.data = bytes.data();
+    view.length = bytes.size();
+    view.original_length = bytes.size() + 4;
+    view.interface_index = static_cast<int>(sequence % 7);
+    view.timestamp = PacketTimestamp(std::chrono::nanoseconds(sequence));
+  }
+};
+
+uint32_t sequenceOf(const PacketView& view) {
+  uint32_t sequence = 0;
+  std::memcpy(&sequence, view.data, sizeof(sequence));
+  return sequence;
+}
+
+// Whether view holds frame sequence intact, truncation included
+bool sameFrame(const PacketView& view, uint32_t sequence) {
+  TestFrame expected(sequence);
+  size_t kept = std::min(expected.bytes.size(), MAX_PACKET_SIZE);
+  return view.length == kept && view.original_length == expected.view.original_length &&
+         view.interface_index == expected.view.interface_index && view.timestamp == expected.view.timestamp &&
+         std::memcmp(view.data, expected.bytes.data(), kept) == 0;
+}
+
+bool pushFrame(RingBuffer& ring, uint32_t sequence) {
+  TestFrame frame(sequence);
+  return ring.push(frame.view);
+}
+
+// Pops everything queued, checking each frame, and returns their sequences
+std::vector<uint32_t> drain(RingBuffer& ring) {
+  std::vector<uint32_t> sequences;
+  RawPacket packet;
+  while (ring.pop(packet)) {
+    uint32_t sequence = sequenceOf(packet.view());
+    expect(sameFrame(packet.view(), sequence), "Frame " + std::to_string(sequence) + " corrupted");
+    sequences.push_back(sequence);
+  }
+  return sequences;
+}
+
+// Many passes over a small ring with every record size: frames come out intact and in order across the wrap
+void testWrap() {
+  RingBuffer ring(RING_BUFFER_MIN_BYTES);
+  uint32_t next_push = 0;
+  uint32_t next_pop = 0;
+
+  for (int round = 0; round < 200; round++) {
+    for (int i = 0; i < 5; i++) {
+      expect(pushFrame(ring, next_push++), "Push refused with room left");
+    }
+    for (uint32_t sequence : drain(ring)) {
+      expect(sequence == next_pop++, "Frame " + std::to_string(sequence) + " out of order");
+    }
+  }
+  expect(next_pop == next_push, "Frames lost across the wrap");
+  expect(ring.getDroppedNewestCount() + ring.getDroppedOldestCount() + ring.getBlockTimeoutCount() == 0,
+         "Drop counted without overflow");
+}
+
+// Pushes frames from 0 until count have been offered, returns how many the ring kept
+uint32_t fill(RingBuffer& ring, uint32_t count) {
+  uint32_t kept = 0;
+  for (uint32_t sequence = 0; sequence < count; sequence++) {
+    kept += pushFrame(ring, sequence) ? 1 : 0;
+  }
+  return kept;
+}
+
+void testDropNewest() {
+  RingBuffer ring(RING_BUFFER_MIN_BYTES, OverflowPolicy::DropNewest);
+  uint32_t kept = fill(ring, 100);
+  std::vector<uint32_t> sequences = drain(ring);
+
+  // Whatever did not fit is refused, the frames queued first stay
+  expect(kept < 100 && ring.getDroppedNewestCount() == 100 - kept, "DropNewest miscounted");
+  expect(ring.getDroppedOldestCount() == 0 && ring.getBlockTimeoutCount() == 0, "DropNewest moved other counters");
+  expect(sequences.size() == kept && !sequences.empty() && sequences.front() == 0, "DropNewest kept the wrong frames");
+  for (size_t i = 1; i < sequences.size(); i++) {
+    expect(sequences[i] > sequences[i - 1], "DropNewest reordered frames");
+  }
+}
+
+void testDropOldest() {
+  RingBuffer ring(RING_BUFFER_MIN_BYTES, OverflowPolicy::DropOldest);
+  uint32_t kept = fill(ring, 100);
+  std::vector<uint32_t> sequences = drain(ring);
+
+  // Every frame goes in, the queue ends up holding the newest ones back to back
+  expect(kept == 100 && !sequences.empty() && sequences.back() == 99, "DropOldest refused a frame");
+  expect(ring.getDroppedOldestCount() == 100 - sequences.size(), "DropOldest miscounted");
+  expect(ring.getDroppedNewestCount() == 0 && ring.getBlockTimeoutCount() == 0, "DropOldest moved other counters");
+  for (size_t i = 1; i < sequences.size(); i++) {
+    expect(sequences[i] == sequences[i - 1] + 1, "DropOldest left a gap");
+  }
+
+  // A claimed batch cannot be evicted: once only it stands in the way, the push gives up after the timeout
+  RingBuffer held(RING_BUFFER_MIN_BYTES, OverflowPolicy::DropOldest, 20ms);
+  fill(held, 100);
+  PacketView views[PROCESSING_BATCH_SIZE];
+  size_t claimed = held.peekBatch(views, PROCESSING_BATCH_SIZE);
+  uint32_t next = 100;
+  while (pushFrame(held, next)) {
+    next++;
+  }
+  expect(held.getDroppedNewestCount() == 1, "DropOldest did not fall back to dropping the incoming frame");
+  for (size_t i = 0; i < claimed; i++) {
+    expect(sameFrame(views[i], sequenceOf(views[i])), "Claimed frame overwritten");
+  }
+
+  // Releasing from another thread ends the wait before the timeout
+  std::thread consumer([&held] {
+    std::this_thread::sleep_for(5ms);
+    held.releaseBatch();
+  });
+  bool pushed = pushFrame(held, next);
+  consumer.join();
+  std::vector<uint32_t> after = drain(held);
+  expect(pushed && !after.empty() && after.back() == next, "releaseBatch() did not wake the producer");
+}
+
+void testBlock() {
+  RingBuffer ring(RING_BUFFER_MIN_BYTES, OverflowPolicy::Block, 20ms);
+  uint32_t next = 0;
+  while (pushFrame(ring, next)) {
+    next++;
+  }
+  expect(ring.getBlockTimeoutCount() == 1, "Block did not time out on a full ring");
+  expect(ring.getDroppedNewestCount() == 0 && ring.getDroppedOldestCount() == 0, "Block moved other counters");
+
+  // The producer sleeps until the consumer frees space, well before the timeout
+  RingBuffer slow(RING_BUFFER_MIN_BYTES, OverflowPolicy::Block, 2000ms);
+  uint32_t queued = 0;
+  while (slow.reserve(MAX_PACKET_SIZE) != nullptr) {
+    pushFrame(slow, queued++);
+  }
+  std::thread consumer([&slow] {
+    std::this_thread::sleep_for(10ms);
+    RawPacket packet;
+    while (slow.pop(packet)) {
+    }
+  });
+  auto start = std::chrono::steady_clock::now();
+  bool pushed = pushFrame(slow, queued);
+  consumer.join();
+  expect(pushed && std::chrono::steady_clock::now() - start < 1000ms, "Block producer not woken by the consumer");
+  expect(slow.getBlockTimeoutCount() == 0, "Block timed out although space was freed");
+}
+
+void testBatches() {
+  RingBuffer ring(RING_BUFFER_MIN_BYTES);
+  std::vector<TestFrame> frames;
+  for (uint32_t sequence = 0; sequence < 6; sequence++) {
+    frames.emplace_back(sequence, 100 + sequence);
+  }
+  std::vector<PacketView> views;
+  for (const TestFrame& frame : frames) {
+    views.push_back(frame.view);
+  }
+  expect(ring.pushBatch(views.data(), views.size()) == views.size(), "pushBatch() refused frames");
+
+  // Views point into the ring, not at the pushed bytes, and stay claimed until released
+  PacketView peeked[4];
+  size_t count = ring.peekBatch(peeked, 4);
+  expect(count == 4, "peekBatch() ignored max_count");
+  for (size_t i = 0; i < count; i++) {
+    expect(peeked[i].data != frames[i].bytes.data() && peeked[i].length == frames[i].bytes.size() &&
+               std::memcmp(peeked[i].data, frames[i].bytes.data(), peeked[i].length) == 0,
+           "peekBatch() view " + std::to_string(i) + " wrong");
+  }
+  ring.releaseBatch();
+
+  count = ring.peekBatch(peeked, 4);
+  expect(count == 2 && sequenceOf(peeked[0]) == 4 && sequenceOf(peeked[1]) == 5, "Second batch wrong");
+  ring.releaseBatch();
+  expect(ring.peekBatch(peeked, 4) == 0, "Ring not empty after the last release");
+}
+
+void testReserve() {
+  RingBuffer ring(RING_BUFFER_MIN_BYTES);
+
+  // Filled in place, then published without a copy
+  uint32_t sequence = 0;
+  while (true) {
+    TestFrame frame(sequence, 1500);
+    uint8_t* space = ring.reserve(frame.bytes.size());
+    if (space == nullptr) {
+      break;
+    }
+    std::memcpy(space, frame.bytes.data(), frame.bytes.size());
+    frame.view.data = space;
+    expect(ring.push(frame.view), "Push into reserved space refused");
+    sequence++;
+  }
+  expect(sequence > 1, "reserve() refused an empty ring");
+  expect(ring.getDroppedNewestCount() == 0, "reserve() on a full ring counted a drop");
+
+  RawPacket packet;
+  for (uint32_t expected = 0; expected < sequence; expected++) {
+    TestFrame frame(expected, 1500);
+    expect(ring.pop(packet) && packet.length == frame.bytes.size() &&
+               std::memcmp(packet.data.data(), frame.bytes.data(), packet.length) == 0,
+           "Reserved frame " + std::to_string(expected) + " wrong");
+  }
+  expect(ring.reserve(MAX_PACKET_SIZE) != nullptr, "reserve() refused after draining");
+}
+
+// A consumer that ran out of spins and parked must wake up on a push, and on notifyConsumer()
+void testWakeup(WaitStrategy strategy) {
+  RingBuffer ring(RING_BUFFER_MIN_BYTES, OverflowPolicy::DropNewest, 100ms, strategy);
+  std::atomic<int> woken{0};
+  std::atomic<bool> stop{false};
+
+  std::thread consumer([&] {
+    while (!stop.load()) {
+      ring.waitForData();
+      RawPacket packet;
+      while (ring.pop(packet)) {
+        woken.fetch_add(1);
+      }
+    }
+  });
+
+  auto waitFor = [&woken](int value) {
+    auto deadline = std::chrono::steady_clock::now() + 2s;
+    while (woken.load() < value && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(1ms);
+    }
+    return woken.load() >= value;
+  };
+
+  for (int round = 1; round <= 3; round++) {
+    std::this_thread::sleep_for(20ms);
+    pushFrame(ring, round);
+    expect(waitFor(round), "Consumer not woken by push " + std::to_string(round));
+  }
+
+  // Parked on an empty ring, only the notification can get it out
+  std::this_thread::sleep_for(20ms);
+  stop.store(true);
+  ring.notifyConsumer();
+  consumer.join();
+}
+
+// Producer and consumer on their own threads: every frame the consumer sees is intact and in order, and every
+// missing one is accounted for by the policy's counters
+void testStress(OverflowPolicy policy, const char* name) {
+  constexpr uint32_t FRAMES = 200000;
+  RingBuffer ring(RING_BUFFER_MIN_BYTES, policy, 5ms);
+  std::atomic<bool> done{false};
+  uint32_t received = 0;
+  uint32_t bad = 0;
+
+  std::thread consumer([&] {
+    PacketView views[PROCESSING_BATCH_SIZE];
+    int64_t last = -1;
+    uint32_t batches = 0;
+    while (true) {
+      bool finished = done.load();
+      size_t count = ring.peekBatch(views, PROCESSING_BATCH_SIZE);
+      for (size_t i = 0; i < count; i++) {
+        uint32_t sequence = sequenceOf(views[i]);
+        if (static_cast<int64_t>(sequence) <= last || !sameFrame(views[i], sequence)) {
+          bad++;
+        }
+        last = sequence;
+      }
+      received += static_cast<uint32_t>(count);
+      // Now and then hold the claim, so the producer runs into it
+      if (count > 0 && ++batches % 128 == 0) {
+        std::this_thread::sleep_for(1ms);
+      }
+      ring.releaseBatch();
+      if (count == 0) {
+        if (finished) {
+          break;
+        }
+        ring.waitForData();
+      }
+    }
+  });
+
+  for (uint32_t sequence = 0; sequence < FRAMES; sequence++) {
+    pushFrame(ring, sequence);
+  }
+  done.store(true);
+  ring.notifyConsumer();
+  consumer.join();
+
+  uint64_t lost = ring.getDroppedNewestCount() + ring.getDroppedOldestCount() + ring.getBlockTimeoutCount();
+  std::cout << name << ": " << received << " received, " << ring.getDroppedNewestCount() << " dropped newest, "
+            << ring.getDroppedOldestCount() << " dropped oldest, " << ring.getBlockTimeoutCount() << " timed out"
+            << std::endl;
+  expect(bad == 0, std::string(name) + ": " + std::to_string(bad) + " frames out of order or corrupt");
+  expect(received + lost == FRAMES, std::string(name) + ": counters do not add up to the frames pushed");
+  expect(policy == OverflowPolicy::DropOldest || ring.getDroppedOldestCount() == 0,
+         std::string(name) + ": evicted frames");
+  expect(policy == OverflowPolicy::Block || ring.getBlockTimeoutCount() == 0, std::string(name) + ": timed out");
+}
+
+} // namespace
+
+int main() {
+  testWrap();
+  testDropNewest();
+  testDropOldest();
+  testBlock();
+  testBatches();
+  testReserve();
+  testWakeup(WaitStrategy::SpinPark);
+  testWakeup(WaitStrategy::SpinYield);
+  testStress(OverflowPolicy::DropNewest, "drop-newest");
+  testStress(OverflowPolicy::DropOldest, "drop-oldest");
+  testStress(OverflowPolicy::Block, "block");
+
+  if (failures > 0) {
+    return 1;
+  }
+  std::cout << "Ring buffer tests passed" << std::endl;
+  return 0;
+}
@@ -0,0 +1,160 @@
+#include "../src/cpp/parser/packet_parser.hpp"
+#include "../src/cpp/sniffer/network_sniffer.hpp"
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// NetworkSniffer::setParser() every couple of milliseconds while UDP traffic runs over loopback, with one parser
+// thread and eagerly decoded packets, then with a ParserPool and lazily decoded ones. Every packet must come
+// through fully parsed, and the ones sent after the last swap must be parsed with the parser it installed.
+// Needs root; skipped otherwise.
+
+namespace {
+
+constexpr uint16_t TEST_PORT = 40123;
+constexpr uint32_t RELOADED_PACKETS = 3000;
+constexpr uint32_t FINAL_PACKETS = 300;
+constexpr uint32_t TOTAL_PACKETS = RELOADED_PACKETS + FINAL_PACKETS;
+
+std::string protocolsPath() {
+  std::string tests_dir = std::string(__FILE__).substr(0, std::string(__FILE__).find_last_of("/\\"));
+  return tests_dir + "/../../core-node/assets/protocols/ethernet.json";
+}
+
+std::unique_ptr<PacketParser> makeParser() {
+  auto parser = std::make_unique<PacketParser>();
+  parser->setProtocolEntryFile(protocolsPath());
+  return parser;
+}
+
+struct Observed {
+  std::vector<std::atomic<uint8_t>> seen = std::vector<std::atomic<uint8_t>>(TOTAL_PACKETS);
+  std::atomic<uint32_t> incomplete{0};
+  std::atomic<uint32_t> stale{0};
+  std::atomic<const ProtocolGraph*> final_graph{nullptr};
+};
+
+// Loopback shows each datagram twice, outgoing and incoming; both must parse the same way
+class ReloadCallback : public PacketCallback {
+public:
+  ReloadCallback(Observed& observed, ParseMode mode) : observed_(observed), mode_(mode) {}
+
+  void operator()(const PacketView& packet, const ParsedPacket& parsed) const override {
+    ParsedPacket decoded = parsed;
+    if (mode_ == ParseMode::Lazy) {
+      // The graph of a parser swapped out since must still be alive
+      decoded.decodeAll(packet);
+    }
+
+    uint64_t port = 0;
+    uint32_t port_field = decoded.graph ? decoded.graph->findField("UDP", 16, 16) : NO_PROTOCOL_FIELD;
+    if (decoded.layers.size() != 3 || !decoded.getValue(port_field, port) || port != TEST_PORT ||
+        packet.length < 46) {
+      observed_.incomplete.fetch_add(1);
+      return;
+    }
+
+    uint32_t sequence = 0;
+    std::memcpy(&sequence, packet.data + 42, sizeof(sequence));
+    if (sequence >= TOTAL_PACKETS) {
+      observed_.incomplete.fetch_add(1);
+      return;
+    }
+    observed_.seen[sequence].store(1);
+    if (sequence >= RELOADED_PACKETS && decoded.graph.get() != observed_.final_graph.load()) {
+      observed_.stale.fetch_add(1);
+    }
+  }
+
+private:
+  Observed& observed_;
+  ParseMode mode_;
+};
+
+void sendPackets(int fd, uint32_t first, uint32_t last) {
+  struct sockaddr_in address;
+  std::memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_port = htons(TEST_PORT);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  for (uint32_t sequence = first; sequence < last; sequence++) {
+    uint8_t payload[32] = {};
+    std::memcpy(payload, &sequence, sizeof(sequence));
+    sendto(fd, payload, sizeof(payload), 0, reinterpret_cast<struct sockaddr*>(&address), sizeof(address));
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+}
+
+bool runSession(size_t parser_threads, ParseMode mode) {
+  NetworkSniffer sniffer;
+  sniffer.setParser(makeParser());
+
+  Observed observed;
+  SnifferOptions options;
+  options.parser_threads = parser_threads;
+  options.parse_mode = mode;
+  options.filter = "udp dst port " + std::to_string(TEST_PORT);
+  if (!sniffer.startSniffing("lo", std::make_unique<ReloadCallback>(observed, mode), options)) {
+    std::cerr << "Capture did not start: " << sniffer.getLastError() << std::endl;
+    return false;
+  }
+
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  std::atomic<bool> sending{true};
+  uint64_t reloads = 0;
+  std::thread reloader([&] {
+    while (sending.load()) {
+      sniffer.setParser(makeParser());
+      reloads++;
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+  });
+  sendPackets(fd, 0, RELOADED_PACKETS);
+  sending.store(false);
+  reloader.join();
+
+  // Its graph is published before the swap, every packet sent afterwards must be parsed with it
+  std::unique_ptr<PacketParser> final_parser = makeParser();
+  observed.final_graph.store(final_parser->getGraph().get());
+  sniffer.setParser(std::move(final_parser));
+  reloads++;
+  sendPackets(fd, RELOADED_PACKETS, TOTAL_PACKETS);
+  close(fd);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  CaptureStats stats = sniffer.getStats();
+  sniffer.stopSniffing();
+
+  uint32_t missing = 0;
+  for (const std::atomic<uint8_t>& seen : observed.seen) {
+    missing += seen.load() == 0 ? 1 : 0;
+  }
+  std::cout << parser_threads << " parser thread(s), " << (mode == ParseMode::Lazy ? "lazy" : "eager") << ": "
+            << stats.protocol_reloads << "/" << reloads << " reloads, " << missing << " missing, "
+            << observed.incomplete.load() << " incomplete, " << observed.stale.load() << " parsed with a stale parser"
+            << std::endl;
+  return stats.protocol_reloads == reloads && missing == 0 && observed.incomplete.load() == 0 &&
+         observed.stale.load() == 0;
+}
+
+} // namespace
+
+int main() {
+  if (geteuid() != 0) {
+    std::cout << "Skipped: packet capture needs root" << std::endl;
+    return 0;
+  }
+
+  bool ok = runSession(1, ParseMode::Eager);
+  ok = runSession(3, ParseMode::Lazy) && ok;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,152 @@
+#include "../src/cpp/sniffer/packet_capture.hpp"
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <linux/if_packet.h>
+#include <net/if.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// AF_XDP capture in generic (skb) mode on a veth pair: frames sent from the peer must all arrive, in order and
+// intact, through more UMEM frames than the ring holds, while a regular packet socket on the same interface
+// sees none of them. Needs root; skipped otherwise.
+
+namespace {
+
+const char* CAPTURE_INTERFACE = "pnxdp0";
+const char* PEER_INTERFACE = "pnxdp1";
+constexpr uint16_t TEST_ETHER_TYPE = 0x88B5; // IEEE local experimental
+constexpr uint32_t FRAME_COUNT = 256;
+constexpr uint32_t SENT_FRAMES = 4 * FRAME_COUNT;
+constexpr size_t FRAME_LENGTH = 128;
+
+bool run(const std::string& command) {
+  return std::system((command + " >/dev/null 2>&1").c_str()) == 0;
+}
+
+int openPacketSocket(const char* interface_name) {
+  int fd = socket(AF_PACKET, SOCK_RAW | SOCK_NONBLOCK, htons(ETH_P_ALL));
+  if (fd < 0) {
+    return -1;
+  }
+  struct sockaddr_ll address;
+  std::memset(&address, 0, sizeof(address));
+  address.sll_family = AF_PACKET;
+  address.sll_protocol = htons(ETH_P_ALL);
+  address.sll_ifindex = static_cast<int>(if_nametoindex(interface_name));
+  if (bind(fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+std::vector<uint8_t> testFrame(uint32_t sequence) {
+  std::vector<uint8_t> frame(FRAME_LENGTH);
+  std::memset(frame.data(), 0xff, 6);
+  frame[6] = 0x02;
+  frame[12] = TEST_ETHER_TYPE >> 8;
+  frame[13] = TEST_ETHER_TYPE & 0xff;
+  for (size_t i = 14; i < frame.size(); i++) {
+    frame[i] = static_cast<uint8_t>(sequence + i);
+  }
+  std::memcpy(frame.data() + 14, &sequence, sizeof(sequence));
+  return frame;
+}
+
+int test() {
+  if (!run(std::string("ip link add ") + CAPTURE_INTERFACE + " type veth peer name " + PEER_INTERFACE) ||
+      !run(std::string("ip link set ") + CAPTURE_INTERFACE + " up") ||
+      !run(std::string("ip link set ") + PEER_INTERFACE + " up")) {
+    std::cout << "Skipped: cannot create a veth pair" << std::endl;
+    return 0;
+  }
+
+  // Only the test frames pass the user-space filter: ldh [12]; jeq #0x88b5; ret #len; ret #0
+  CaptureOptions options;
+  options.mode = CaptureMode::Xdp;
+  options.xdp_frame_count = FRAME_COUNT;
+  options.xdp_generic = true;
+  options.filter = {BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 12), BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, TEST_ETHER_TYPE, 0, 1),
+                    BPF_STMT(BPF_RET | BPF_K, FILTER_ACCEPT_LENGTH), BPF_STMT(BPF_RET | BPF_K, 0)};
+
+  PacketCapture capture(CAPTURE_INTERFACE, options);
+  if (!capture.initialize() || capture.getCaptureMode() != CaptureMode::Xdp) {
+    std::cerr << "AF_XDP capture did not start: " << capture.getLastError() << std::endl;
+    return 1;
+  }
+
+  std::atomic<uint32_t> received{0};
+  std::atomic<uint32_t> corrupt{0};
+  std::thread capture_thread([&] {
+    capture.startCapture([&](const PacketView* packets, size_t count) {
+      for (size_t i = 0; i < count; i++) {
+        uint32_t expected = received.load(std::memory_order_relaxed);
+        std::vector<uint8_t> frame = testFrame(expected);
+        if (packets[i].length != frame.size() || std::memcmp(packets[i].data, frame.data(), frame.size()) != 0) {
+          corrupt.fetch_add(1);
+        }
+        received.fetch_add(1);
+      }
+    });
+  });
+
+  int stack_socket = openPacketSocket(CAPTURE_INTERFACE);
+  int sender = openPacketSocket(PEER_INTERFACE);
+  if (stack_socket < 0 || sender < 0) {
+    std::cerr << "Cannot open packet sockets: " << strerror(errno) << std::endl;
+    capture.stopCapture();
+    capture_thread.join();
+    return 1;
+  }
+
+  // Paced so the RX ring never overflows, but through every UMEM frame several times
+  for (uint32_t sequence = 0; sequence < SENT_FRAMES; sequence++) {
+    std::vector<uint8_t> frame = testFrame(sequence);
+    while (send(sender, frame.data(), frame.size(), 0) < 0) {
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    if (sequence % 32 == 31) {
+      auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+      while (received.load() <= sequence && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+      }
+    }
+  }
+
+  capture.stopCapture();
+  capture_thread.join();
+
+  uint32_t seen_by_stack = 0;
+  uint8_t buffer[2048];
+  ssize_t length;
+  while ((length = recv(stack_socket, buffer, sizeof(buffer), 0)) >= 0) {
+    if (length >= 14 && buffer[12] == (TEST_ETHER_TYPE >> 8) && buffer[13] == (TEST_ETHER_TYPE & 0xff)) {
+      seen_by_stack++;
+    }
+  }
+  close(stack_socket);
+  close(sender);
+
+  std::cout << received.load() << "/" << SENT_FRAMES << " frames captured, " << corrupt.load() << " out of order or "
+            << "corrupt, " << seen_by_stack << " reached the kernel stack" << std::endl;
+  return received.load() == SENT_FRAMES && corrupt.load() == 0 && seen_by_stack == 0 ? 0 : 1;
+}
+
+} // namespace
+
+int main() {
+  if (geteuid() != 0) {
+    std::cout << "Skipped: AF_XDP needs root" << std::endl;
+    return 0;
+  }
+
+  run(std::string("ip link del ") + CAPTURE_INTERFACE);
+  int result = test();
+  run(std::string("ip link del ") + CAPTURE_INTERFACE);
+  return result;
+}
@@ -0,0 +1,221 @@
+// Build-time generator: compiles the protocol graph reachable from an entry file into C++ for GeneratedParser.
+//
+//   protocol_codegen <entry.json> <output.cpp>
+//
+// The graph is built by the same ProtocolGraph::build() the interpreting parser uses, then each node becomes a
+// constexpr field table and a decode function with its extent, selector, next-protocol switch and start_after
+// arithmetic as constants.
+
+#include "parser/protocol_graph.hpp"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string quote(const std::string& text) {
+  std::ostringstream out;
+  out << '"';
+  for (char c : text) {
+    switch (c) {
+    case '"':
+      out << "\\\"";
+      break;
+    case '\\':
+      out << "\\\\";
+      break;
+    case '\n':
+      out << "\\n\"\n    \"";
+      break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20) {
+        out << "\\x" << std::hex << static_cast<int>(c) << std::dec << "\"\"";
+      } else {
+        out << c;
+      }
+    }
+  }
+  out << '"';
+  return out.str();
+}
+
+// The start_after stack program as one C++ expression over values[], same operations in the same order
+std::string startAfterExpression(const StartAfter& start_after) {
+  std::vector<std::string> stack;
+  for (const StartAfter::Op& op : start_after.getProgram()) {
+    std::ostringstream term;
+    switch (op.code) {
+    case StartAfter::Op::Push:
+      term << std::hexfloat << op.value;
+      stack.push_back(term.str());
+      continue;
+    case StartAfter::Op::Load:
+      term << "static_cast<double>(values[" << op.field << "])";
+      stack.push_back(term.str());
+      continue;
+    case StartAfter::Op::Negate:
+      stack.back() = "(-" + stack.back() + ")";
+      continue;
+    default:
+      break;
+    }
+
+    std::string right = stack.back();
+    stack.pop_back();
+    std::string& left = stack.back();
+    switch (op.code) {
+    case StartAfter::Op::Add:
+      left = "(" + left + " + " + right + ")";
+      break;
+    case StartAfter::Op::Subtract:
+      left = "(" + left + " - " + right + ")";
+      break;
+    case StartAfter::Op::Multiply:
+      left = "(" + left + " * " + right + ")";
+      break;
+    case StartAfter::Op::Divide:
+      left = "(" + left + " / " + right + ")";
+      break;
+    default:
+      left = "std::fmod(" + left + ", " + right + ")";
+      break;
+    }
+  }
+  return "StartAfter::toBits(" + stack.back() + ")";
+}
+
+void writeNode(std::ostream& out, const ProtocolNode& node) {
+  size_t count = node.fields.size();
+  std::string fields = "kFields" + std::to_string(node.id);
+
+  out << "// " << node.name << ", " << std::filesystem::path(node.file).filename().string() << "\n";
+  if (count > 0) {
+    out << "constexpr GeneratedField " << fields << "[] = {";
+    for (size_t i = 0; i < count; i++) {
+      out << (i == 0 ? "" : ", ") << "{" << node.fields[i].offset << ", " << node.fields[i].length << "}";
+    }
+    out << "};\n";
+  }
+
+  out << "uint32_t decodeLayer" << node.id
+      << "([[maybe_unused]] const uint8_t* data, [[maybe_unused]] size_t length,\n"
+      << "                      [[maybe_unused]] uint32_t& bit_offset, [[maybe_unused]] uint64_t* values) {\n";
+  if (count == 0 && !node.has_next) {
+    out << "  return NO_PROTOCOL_NODE;\n}\n\n";
+    return;
+  }
+
+  std::string sequence = "std::make_index_sequence<" + std::to_string(count) + ">()";
+  std::string selector_reader =
+      "FieldReader<" + std::to_string(node.selector_offset) + ", " + std::to_string(node.selector_length) + ">";
+
+  if (node.has_next) {
+    out << "  uint64_t selector;\n";
+  }
+  out << "  uint32_t layer_byte = bit_offset / 8;\n";
+  out << "  if (bit_offset % 8 == 0 && layer_byte <= length && " << node.extent_bytes
+      << " <= length - layer_byte) {\n";
+  out << "    const uint8_t* layer = data + layer_byte;\n";
+  if (count > 0) {
+    out << "    readFields<" << fields << ">(layer, values, " << sequence << ");\n";
+  }
+  if (node.has_next) {
+    out << "    selector = " << selector_reader << "::read(layer);\n";
+  }
+  out << "  } else {\n";
+  if (count > 0) {
+    out << "    extractFieldBits<" << fields << ">(data, length, bit_offset, values, " << sequence << ");\n";
+  }
+  if (node.has_next) {
+    out << "    selector = extractBits(data, length, bit_offset + " << node.selector_offset << ", "
+        << node.selector_length << ");\n";
+  }
+  out << "  }\n";
+
+  if (!node.has_next || node.next_nodes.empty()) {
+    out << "  return NO_PROTOCOL_NODE;\n}\n\n";
+    return;
+  }
+
+  out << "\n  uint32_t next;\n";
+  out << "  switch (static_cast<uint16_t>(selector)) {\n";
+  for (const auto& [value, next_id] : node.next_nodes) {
+    char label[8];
+    std::snprintf(label, sizeof(label), "0x%04X", value);
+    out << "  case " << label << ":\n    next = " << next_id << ";\n    break;\n";
+  }
+  out << "  default:\n    return NO_PROTOCOL_NODE;\n  }\n";
+
+  if (!node.start_after.isConstant()) {
+    out << "  bit_offset += " << startAfterExpression(node.start_after) << ";\n";
+  } else if (node.start_after.getConstant() != 0) {
+    out << "  bit_offset += " << node.start_after.getConstant() << ";\n";
+  }
+  out << "  return next;\n}\n\n";
+}
+
+std::string generate(const ProtocolGraph& graph) {
+  std::ostringstream out;
+  out << "// Generated by tools/protocol_codegen.cpp from "
+      << std::filesystem::path(graph.getEntryFile()).filename().string() << ", do not edit\n\n";
+  out << "#include \"parser/generated_protocols.hpp\"\n";
+  out << "#include \"parser/protocol_graph.hpp\"\n";
+  out << "#include <cmath>\n\n";
+
+  for (size_t id = 0; id < graph.size(); id++) {
+    const ProtocolNode& node = graph.node(static_cast<uint32_t>(id));
+    if (node.has_next && !node.start_after.isNative()) {
+      std::cerr << "protocol_codegen: start_after of " << node.file << " needs ExprTk, generating an empty table"
+                << std::endl;
+      out << "const GeneratedProtocolTable* getGeneratedProtocolTable() {\n  return nullptr;\n}\n";
+      return out.str();
+    }
+  }
+
+  out << "namespace {\n\n";
+  for (size_t id = 0; id < graph.size(); id++) {
+    writeNode(out, graph.node(static_cast<uint32_t>(id)));
+  }
+
+  out << "constexpr uint32_t kFieldCounts[] = {";
+  for (size_t id = 0; id < graph.size(); id++) {
+    out << (id == 0 ? "" : ", ") << graph.node(static_cast<uint32_t>(id)).fields.size();
+  }
+  out << "};\n";
+  out << "constexpr GeneratedProtocolTable::DecodeLayer kDecoders[] = {";
+  for (size_t id = 0; id < graph.size(); id++) {
+    out << (id == 0 ? "" : ", ") << "decodeLayer" << id;
+  }
+  out << "};\n";
+  out << "constexpr const char* kSignature =\n    " << quote(graph.getSignature()) << ";\n\n";
+  out << "constexpr GeneratedProtocolTable kTable = {kSignature, " << graph.size() << ", kFieldCounts, kDecoders};\n\n";
+  out << "} // namespace\n\n";
+  out << "const GeneratedProtocolTable* getGeneratedProtocolTable() {\n  return &kTable;\n}\n";
+  return out.str();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  if (argc != 3) {
+    std::cerr << "Usage: protocol_codegen <entry.json> <output.cpp>" << std::endl;
+    return 2;
+  }
+
+  std::shared_ptr<const ProtocolGraph> graph = ProtocolGraph::build(argv[1]);
+  if (graph->entry() == nullptr) {
+    std::cerr << "protocol_codegen: could not load " << argv[1] << std::endl;
+    return 1;
+  }
+  std::ofstream output(argv[2], std::ios::binary | std::ios::trunc);
+  output << generate(*graph);
+  if (!output) {
+    std::cerr << "protocol_codegen: could not write " << argv[2] << std::endl;
+    return 1;
+  }
+  return 0;
+}
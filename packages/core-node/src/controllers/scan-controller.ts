@@ -13,13 +13,13 @@ import { HostAnalyser, type HostBaseData } from '@repo/utils'
 export type PacketDataWithoutRaw = {
     id: number
     parsed: ParsedPacket
-    raw: Omit<RawPacketData, 'data'>
+    raw: Omit<RawPacketData, 'data' | 'timestampNs'>
 }
 
 export interface PacketData {
     id: number
     parsed: ParsedPacket
-    raw: RawPacketData<string>
+    raw: Omit<RawPacketData<string>, 'timestampNs'> & { timestampNs: string }
 }
 
 export type SniffingEvent =
@@ -77,6 +77,8 @@ export class ScanController {
                                         parsed: packet.parsed,
                                         raw: {
                                             length: packet.raw.length,
+                                            originalLength: packet.raw.originalLength,
+                                            interfaceIndex: packet.raw.interfaceIndex,
                                             timestamp: packet.raw.timestamp - startTime,
                                             valid: packet.raw.valid,
                                         },
@@ -161,6 +163,7 @@ export class ScanController {
                     raw: {
                         ...packet.raw,
                         data: Buffer.from(packet.raw.data).toString('base64'),
+                        timestampNs: packet.raw.timestampNs.toString(),
                     },
                 }
             })